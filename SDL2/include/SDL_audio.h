@@ -720,6 +720,32 @@ extern DECLSPEC SDL_AudioStatus SDLCALL SDL_GetAudioStatus(void);
  * \sa SDL_PauseAudioDevice
  */
 extern DECLSPEC SDL_AudioStatus SDLCALL SDL_GetAudioDeviceStatus(SDL_AudioDeviceID dev);
+
+/**
+ * Get how much audio an output device has been given but not yet played.
+ *
+ * This is the time between the audio callback handing a buffer to SDL and
+ * that buffer being heard, measured from the start of the buffer the next
+ * callback will fill. It covers what the backend and the hardware have queued,
+ * and any data SDL is holding to convert to the device's format.
+ *
+ * The value is most meaningful when read from inside the audio callback,
+ * where it can be used to timestamp the buffer being filled.
+ *
+ * Only some backends can report this (ALSA, PulseAudio and PipeWire at the
+ * moment); the others return -1.
+ *
+ * \param dev the ID of an output device previously opened with
+ *            SDL_OpenAudioDevice()
+ * \returns the latency in sample frames at the rate of the obtained audio
+ *          spec, or -1 on error or if the backend can't tell; call
+ *          SDL_GetError() for more information.
+ *
+ * \since This function is available since SDL 2.29.0.
+ *
+ * \sa SDL_OpenAudioDevice
+ */
+extern DECLSPEC int SDLCALL SDL_GetAudioDeviceLatency(SDL_AudioDeviceID dev);
 /* @} *//* Audio State */
 
 /**
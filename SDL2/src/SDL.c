@@ -52,6 +52,7 @@
 #include "haptic/SDL_haptic_c.h"
 #include "joystick/SDL_joystick_c.h"
 #include "sensor/SDL_sensor_c.h"
+#include "video/SDL_yuv_c.h"
 
 /* Initialization/Cleanup routines */
 #if !SDL_TIMERS_DISABLED
@@ -486,6 +487,7 @@ void SDL_Quit(void)
     SDL_TicksQuit();
 #endif
 
+    SDL_YUVQuit();
     SDL_ClearHints();
     SDL_AssertionsQuit();
 
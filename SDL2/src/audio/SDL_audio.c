@@ -1576,6 +1576,36 @@ SDL_AudioStatus SDL_GetAudioDeviceStatus(SDL_AudioDeviceID devid)
     return status;
 }
 
+int SDL_GetAudioDeviceLatency(SDL_AudioDeviceID devid)
+{
+    SDL_AudioDevice *device = get_audio_device(devid);
+    int frames;
+
+    if (!device) {
+        return -1;
+    }
+    if (device->iscapture) {
+        return SDL_Unsupported();
+    }
+    if (current_audio.impl.GetDeviceLatency == NULL) {
+        return SDL_Unsupported();
+    }
+
+    current_audio.impl.LockDevice(device);
+    frames = current_audio.impl.GetDeviceLatency(device);
+    if (frames >= 0 && device->stream) {
+        /* converted data SDL holds back until the device asks for more */
+        const int frame_size = (SDL_AUDIO_BITSIZE(device->spec.format) / 8) * device->spec.channels;
+        frames += SDL_AudioStreamAvailable(device->stream) / frame_size;
+    }
+    current_audio.impl.UnlockDevice(device);
+
+    if (frames >= 0 && device->spec.freq != device->callbackspec.freq) {
+        frames = (int)(((Sint64)frames * device->callbackspec.freq) / device->spec.freq);
+    }
+    return frames;
+}
+
 SDL_AudioStatus SDL_GetAudioStatus(void)
 {
     return SDL_GetAudioDeviceStatus(1);
@@ -79,6 +79,7 @@ typedef struct SDL_AudioDriverImpl
     void (*FreeDeviceHandle)(void *handle); /**< SDL is done with handle from SDL_AddAudioDevice() */
     void (*Deinitialize)(void);
     int (*GetDefaultAudioInfo)(char **name, SDL_AudioSpec *spec, int iscapture);
+    int (*GetDeviceLatency)(_THIS); /* Sample frames queued past the device buffer, -1 if unknown. Optional. */
 
     /* !!! FIXME: add pause(), so we can optimize instead of mixing silence. */
 
@@ -83,6 +83,7 @@ static int (*ALSA_snd_device_name_hint)(int, const char *, void ***);
 static char *(*ALSA_snd_device_name_get_hint)(const void *, const char *);
 static int (*ALSA_snd_device_name_free_hint)(void **);
 static snd_pcm_sframes_t (*ALSA_snd_pcm_avail)(snd_pcm_t *);
+static int (*ALSA_snd_pcm_delay)(snd_pcm_t *, snd_pcm_sframes_t *);
 #ifdef SND_CHMAP_API_VERSION
 static snd_pcm_chmap_t *(*ALSA_snd_pcm_get_chmap)(snd_pcm_t *);
 static int (*ALSA_snd_pcm_chmap_print)(const snd_pcm_chmap_t *map, size_t maxlen, char *buf);
@@ -152,6 +153,7 @@ static int load_alsa_syms(void)
     SDL_ALSA_SYM(snd_device_name_get_hint);
     SDL_ALSA_SYM(snd_device_name_free_hint);
     SDL_ALSA_SYM(snd_pcm_avail);
+    SDL_ALSA_SYM(snd_pcm_delay);
 #ifdef SND_CHMAP_API_VERSION
     SDL_ALSA_SYM(snd_pcm_get_chmap);
     SDL_ALSA_SYM(snd_pcm_chmap_print);
@@ -403,6 +405,19 @@ static Uint8 *ALSA_GetDeviceBuf(_THIS)
     return this->hidden->mixbuf;
 }
 
+static int ALSA_GetDeviceLatency(_THIS)
+{
+    snd_pcm_sframes_t delay = 0;
+    const int status = ALSA_snd_pcm_delay(this->hidden->pcm_handle, &delay);
+
+    if (status == -EPIPE) {
+        return 0; /* underrun, nothing left queued */
+    } else if (status < 0) {
+        return SDL_SetError("ALSA: snd_pcm_delay failed: %s", ALSA_snd_strerror(status));
+    }
+    return (delay > 0) ? (int)delay : 0;
+}
+
 static int ALSA_CaptureFromDevice(_THIS, void *buffer, int buflen)
 {
     Uint8 *sample_buf = (Uint8 *)buffer;
@@ -971,6 +986,7 @@ static SDL_bool ALSA_Init(SDL_AudioDriverImpl *impl)
     impl->WaitDevice = ALSA_WaitDevice;
     impl->GetDeviceBuf = ALSA_GetDeviceBuf;
     impl->PlayDevice = ALSA_PlayDevice;
+    impl->GetDeviceLatency = ALSA_GetDeviceLatency;
     impl->CloseDevice = ALSA_CloseDevice;
     impl->Deinitialize = ALSA_Deinitialize;
     impl->CaptureFromDevice = ALSA_CaptureFromDevice;
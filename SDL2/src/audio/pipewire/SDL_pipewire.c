@@ -113,6 +113,7 @@ static int (*PIPEWIRE_pw_stream_connect)(struct pw_stream *, enum pw_direction,
 static enum pw_stream_state (*PIPEWIRE_pw_stream_get_state)(struct pw_stream *stream, const char **error);
 static struct pw_buffer *(*PIPEWIRE_pw_stream_dequeue_buffer)(struct pw_stream *);
 static int (*PIPEWIRE_pw_stream_queue_buffer)(struct pw_stream *, struct pw_buffer *);
+static int (*PIPEWIRE_pw_stream_get_time)(struct pw_stream *, struct pw_time *);
 static struct pw_properties *(*PIPEWIRE_pw_properties_new)(const char *, ...)SPA_SENTINEL;
 static int (*PIPEWIRE_pw_properties_set)(struct pw_properties *, const char *, const char *);
 static int (*PIPEWIRE_pw_properties_setf)(struct pw_properties *, const char *, const char *, ...) SPA_PRINTF_FUNC(3, 4);
@@ -198,6 +199,7 @@ static int load_pipewire_syms()
     SDL_PIPEWIRE_SYM(pw_stream_get_state);
     SDL_PIPEWIRE_SYM(pw_stream_dequeue_buffer);
     SDL_PIPEWIRE_SYM(pw_stream_queue_buffer);
+    SDL_PIPEWIRE_SYM(pw_stream_get_time);
     SDL_PIPEWIRE_SYM(pw_properties_new);
     SDL_PIPEWIRE_SYM(pw_properties_set);
     SDL_PIPEWIRE_SYM(pw_properties_setf);
@@ -1011,6 +1013,20 @@ static void output_callback(void *data)
     PIPEWIRE_pw_stream_queue_buffer(stream, pw_buf);
 }
 
+static int PIPEWIRE_GetDeviceLatency(_THIS)
+{
+    struct pw_time t;
+
+    SDL_zero(t);
+    if (PIPEWIRE_pw_stream_get_time(this->hidden->stream, &t) < 0 || t.rate.denom == 0) {
+        return SDL_SetError("Pipewire: stream time not known yet");
+    }
+
+    /* Graph delay is in ticks of the graph rate, queued is what the graph hasn't taken yet */
+    return (int)((t.delay > 0 ? (t.delay * (Sint64)t.rate.num * this->spec.freq) / t.rate.denom : 0) +
+                 (Sint64)t.queued / this->hidden->stride);
+}
+
 static void input_callback(void *data)
 {
     struct pw_buffer *pw_buf;
@@ -1370,6 +1386,7 @@ static SDL_bool PIPEWIRE_Init(SDL_AudioDriverImpl *impl)
     impl->DetectDevices = PIPEWIRE_DetectDevices;
     impl->OpenDevice = PIPEWIRE_OpenDevice;
     impl->CloseDevice = PIPEWIRE_CloseDevice;
+    impl->GetDeviceLatency = PIPEWIRE_GetDeviceLatency;
     impl->Deinitialize = PIPEWIRE_Deinitialize;
     impl->GetDefaultAudioInfo = PIPEWIRE_GetDefaultAudioInfo;
 
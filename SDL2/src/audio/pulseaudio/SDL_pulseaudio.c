@@ -109,6 +109,7 @@ static int (*PULSEAUDIO_pa_stream_peek)(pa_stream *, const void **, size_t *);
 static int (*PULSEAUDIO_pa_stream_drop)(pa_stream *);
 static pa_operation *(*PULSEAUDIO_pa_stream_flush)(pa_stream *,
                                                    pa_stream_success_cb_t, void *);
+static int (*PULSEAUDIO_pa_stream_get_latency)(pa_stream *, pa_usec_t *, int *);
 static int (*PULSEAUDIO_pa_stream_disconnect)(pa_stream *);
 static void (*PULSEAUDIO_pa_stream_unref)(pa_stream *);
 static void (*PULSEAUDIO_pa_stream_set_write_callback)(pa_stream *, pa_stream_request_cb_t, void *);
@@ -220,6 +221,7 @@ static int load_pulseaudio_syms(void)
     SDL_PULSEAUDIO_SYM(pa_stream_peek);
     SDL_PULSEAUDIO_SYM(pa_stream_drop);
     SDL_PULSEAUDIO_SYM(pa_stream_flush);
+    SDL_PULSEAUDIO_SYM(pa_stream_get_latency);
     SDL_PULSEAUDIO_SYM(pa_stream_unref);
     SDL_PULSEAUDIO_SYM(pa_channel_map_init_auto);
     SDL_PULSEAUDIO_SYM(pa_strerror);
@@ -380,6 +382,24 @@ static void WriteCallback(pa_stream *p, size_t nbytes, void *userdata)
     PULSEAUDIO_pa_threaded_mainloop_signal(pulseaudio_threaded_mainloop, 0);
 }
 
+static int PULSEAUDIO_GetDeviceLatency(_THIS)
+{
+    pa_usec_t usec = 0;
+    int negative = 0;
+    int rc;
+
+    PULSEAUDIO_pa_threaded_mainloop_lock(pulseaudio_threaded_mainloop);
+    rc = PULSEAUDIO_pa_stream_get_latency(this->hidden->stream, &usec, &negative);
+    PULSEAUDIO_pa_threaded_mainloop_unlock(pulseaudio_threaded_mainloop);
+
+    if (rc < 0) {
+        return SDL_SetError("pulseaudio: stream latency not known yet");
+    } else if (negative) {
+        return 0;
+    }
+    return (int)((usec * this->spec.freq) / 1000000);
+}
+
 static void PULSEAUDIO_PlayDevice(_THIS)
 {
     struct SDL_PrivateAudioData *h = this->hidden;
@@ -700,6 +720,8 @@ static int PULSEAUDIO_OpenDevice(_THIS, const char *devname)
                 PULSEAUDIO_pa_stream_set_read_callback(h->stream, ReadCallback, h);
                 rc = PULSEAUDIO_pa_stream_connect_record(h->stream, h->device_name, &paattr, flags);
             } else {
+                /* timing updates are what pa_stream_get_latency() reports from */
+                flags |= PA_STREAM_AUTO_TIMING_UPDATE | PA_STREAM_INTERPOLATE_TIMING;
                 PULSEAUDIO_pa_stream_set_write_callback(h->stream, WriteCallback, h);
                 rc = PULSEAUDIO_pa_stream_connect_playback(h->stream, h->device_name, &paattr, flags, NULL, NULL);
             }
@@ -971,6 +993,7 @@ static SDL_bool PULSEAUDIO_Init(SDL_AudioDriverImpl *impl)
     impl->DetectDevices = PULSEAUDIO_DetectDevices;
     impl->OpenDevice = PULSEAUDIO_OpenDevice;
     impl->PlayDevice = PULSEAUDIO_PlayDevice;
+    impl->GetDeviceLatency = PULSEAUDIO_GetDeviceLatency;
     impl->WaitDevice = PULSEAUDIO_WaitDevice;
     impl->GetDeviceBuf = PULSEAUDIO_GetDeviceBuf;
     impl->CloseDevice = PULSEAUDIO_CloseDevice;
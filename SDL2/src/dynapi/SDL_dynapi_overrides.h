@@ -897,3 +897,4 @@
 #define SDL_HasWindowSurface SDL_HasWindowSurface_REAL
 #define SDL_DestroyWindowSurface SDL_DestroyWindowSurface_REAL
 #define SDL_GDKGetDefaultUser SDL_GDKGetDefaultUser_REAL
+#define SDL_GetAudioDeviceLatency SDL_GetAudioDeviceLatency_REAL
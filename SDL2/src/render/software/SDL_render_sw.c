@@ -34,6 +34,8 @@
 #include "SDL_drawpoint.h"
 #include "SDL_rotate.h"
 #include "SDL_triangle.h"
+#include "../../thread/SDL_systhread.h"
+#include "../../video/SDL_pixels_c.h"
 
 /* SDL surface based renderer implementation */
 
@@ -44,12 +46,252 @@ typedef struct
     SDL_bool surface_cliprect_dirty;
 } SW_DrawStateCache;
 
+/* Unscaled copies this large are split into row bands and run on a worker pool.
+ * SDL_RENDER_SW_THREADS sets the pool size, 0 or 1 keeps everything on the calling thread.
+ */
+#define SW_MAX_BAND_THREADS 16
+#define SW_MIN_BAND_ROWS    32
+#define SW_MIN_BAND_PIXELS  (256 * 256)
+
+typedef void (*SW_BandFunc)(void *data, int band, int num_bands);
+
+typedef struct
+{
+    SDL_Thread *threads[SW_MAX_BAND_THREADS];
+    int num_threads;
+    SDL_sem *start_sem;
+    SDL_sem *done_sem;
+    SDL_atomic_t next_band;
+    SDL_atomic_t pending;
+    SDL_bool quit;
+    SW_BandFunc func;
+    void *data;
+    int num_bands;
+} SW_BandPool;
+
+typedef struct
+{
+    SDL_BlitFunc blit;
+    const SDL_BlitInfo *info;
+} SW_BandBlit;
+
 typedef struct
 {
     SDL_Surface *surface;
     SDL_Surface *window;
+    SW_BandPool *pool;
+    SDL_bool pool_checked;
 } SW_RenderData;
 
+/* Returns SDL_TRUE if this call finished the run */
+static SDL_bool SW_RunBands(SW_BandPool *pool)
+{
+    SDL_bool finished = SDL_FALSE;
+    int band;
+
+    while ((band = SDL_AtomicAdd(&pool->next_band, 1)) < pool->num_bands) {
+        pool->func(pool->data, band, pool->num_bands);
+        if (SDL_AtomicAdd(&pool->pending, -1) == 1) {
+            finished = SDL_TRUE;
+        }
+    }
+    return finished;
+}
+
+static int SDLCALL SW_BandThread(void *data)
+{
+    SW_BandPool *pool = (SW_BandPool *)data;
+
+    for (;;) {
+        SDL_SemWait(pool->start_sem);
+        if (pool->quit) {
+            break;
+        }
+        SW_RunBands(pool);
+        /* every woken worker checks out once, so none can straggle into the next run */
+        if (SDL_AtomicAdd(&pool->pending, -1) == 1) {
+            SDL_SemPost(pool->done_sem);
+        }
+    }
+    return 0;
+}
+
+static void SW_DestroyBandPool(SW_BandPool *pool)
+{
+    int i;
+
+    if (pool == NULL) {
+        return;
+    }
+    pool->quit = SDL_TRUE;
+    for (i = 0; i < pool->num_threads; ++i) {
+        SDL_SemPost(pool->start_sem);
+    }
+    for (i = 0; i < pool->num_threads; ++i) {
+        SDL_WaitThread(pool->threads[i], NULL);
+    }
+    if (pool->start_sem) {
+        SDL_DestroySemaphore(pool->start_sem);
+    }
+    if (pool->done_sem) {
+        SDL_DestroySemaphore(pool->done_sem);
+    }
+    SDL_free(pool);
+}
+
+static SW_BandPool *SW_CreateBandPool(void)
+{
+    const char *env = SDL_getenv("SDL_RENDER_SW_THREADS");
+    int num_threads = env ? SDL_atoi(env) - 1 : SDL_GetCPUCount() - 1;
+    SW_BandPool *pool;
+
+    num_threads = SDL_min(num_threads, SW_MAX_BAND_THREADS);
+    if (num_threads <= 0) {
+        return NULL;
+    }
+
+    pool = (SW_BandPool *)SDL_calloc(1, sizeof(*pool));
+    if (pool == NULL) {
+        return NULL;
+    }
+    pool->start_sem = SDL_CreateSemaphore(0);
+    pool->done_sem = SDL_CreateSemaphore(0);
+    if (pool->start_sem == NULL || pool->done_sem == NULL) {
+        SW_DestroyBandPool(pool);
+        return NULL;
+    }
+    while (pool->num_threads < num_threads) {
+        SDL_Thread *thread = SDL_CreateThreadInternal(SW_BandThread, "SDLRenderSW", 0, pool);
+        if (thread == NULL) {
+            break;
+        }
+        pool->threads[pool->num_threads++] = thread;
+    }
+    if (pool->num_threads == 0) {
+        SW_DestroyBandPool(pool);
+        return NULL;
+    }
+    return pool;
+}
+
+/* Runs func over num_bands bands on the pool and the calling thread, returns once all are done */
+static void SW_DispatchBands(SW_BandPool *pool, SW_BandFunc func, void *data, int num_bands)
+{
+    const int wake = SDL_min(pool->num_threads, num_bands - 1);
+    int i;
+
+    pool->func = func;
+    pool->data = data;
+    pool->num_bands = num_bands;
+    SDL_AtomicSet(&pool->pending, num_bands + wake);
+    SDL_AtomicSet(&pool->next_band, 0);
+    for (i = 0; i < wake; ++i) {
+        SDL_SemPost(pool->start_sem);
+    }
+    if (!SW_RunBands(pool)) {
+        SDL_SemWait(pool->done_sem);
+    }
+}
+
+static void SW_BlitBand(void *data, int band, int num_bands)
+{
+    const SW_BandBlit *job = (const SW_BandBlit *)data;
+    SDL_BlitInfo info = *job->info;
+    const int y0 = info.dst_h * band / num_bands;
+    const int y1 = info.dst_h * (band + 1) / num_bands;
+
+    info.src += y0 * info.src_pitch;
+    info.dst += y0 * info.dst_pitch;
+    info.src_h = info.dst_h = y1 - y0;
+    job->blit(&info);
+}
+
+/* The unscaled SDL_BlitSurface(), with the rows of the blit split across the band pool.
+ * Each band runs the mapped blit function on its own copy of the SDL_BlitInfo, as
+ * SDL_SoftBlit() would fill in the shared one. Returns -1 when the blit should be left
+ * to SDL_BlitSurface() instead.
+ */
+static int SW_BlitSurfaceBands(SW_RenderData *data, SDL_Surface *src, const SDL_Rect *srcrect,
+                               SDL_Surface *surface, const SDL_Rect *dstrect)
+{
+    SDL_Rect sr, dr, bounds;
+    SDL_BlitInfo info;
+    SW_BandBlit job;
+    int num_bands;
+
+    if (dstrect->w * dstrect->h < SW_MIN_BAND_PIXELS || dstrect->h < 2 * SW_MIN_BAND_ROWS) {
+        return -1;
+    }
+    if (!data->pool_checked) {
+        data->pool = SW_CreateBandPool();
+        data->pool_checked = SDL_TRUE;
+    }
+    if (data->pool == NULL || src->locked || surface->locked || SDL_MUSTLOCK(surface)) {
+        return -1;
+    }
+
+    /* clip as SDL_UpperBlit() does, the source to its surface, then the destination to the clip rect */
+    bounds.x = bounds.y = 0;
+    bounds.w = src->w;
+    bounds.h = src->h;
+    if (!SDL_IntersectRect(srcrect, &bounds, &sr)) {
+        return 0;
+    }
+    dr.x = dstrect->x + (sr.x - srcrect->x);
+    dr.y = dstrect->y + (sr.y - srcrect->y);
+    dr.w = sr.w;
+    dr.h = sr.h;
+    if (!SDL_IntersectRect(&dr, &surface->clip_rect, &bounds)) {
+        return 0;
+    }
+    sr.x += bounds.x - dr.x;
+    sr.y += bounds.y - dr.y;
+    sr.w = bounds.w;
+    sr.h = bounds.h;
+    dr = bounds;
+
+    /* validate the map up front, as SDL_UpperBlit() and SDL_LowerBlit() would */
+    if (src->map->info.flags & SDL_COPY_NEAREST) {
+        src->map->info.flags &= ~SDL_COPY_NEAREST;
+        SDL_InvalidateMap(src->map);
+    }
+    if ((src->map->dst != surface) ||
+        (surface->format->palette &&
+         src->map->dst_palette_version != surface->format->palette->version) ||
+        (src->format->palette &&
+         src->map->src_palette_version != src->format->palette->version)) {
+        if (SDL_MapSurface(src, surface) < 0) {
+            return -1;
+        }
+    }
+    /* RLE blits walk the encoded runs, they can't start at an arbitrary row */
+    if ((src->flags & SDL_RLEACCEL) || src->map->data == NULL) {
+        return -1;
+    }
+
+    num_bands = SDL_min(data->pool->num_threads + 1, dr.h / SW_MIN_BAND_ROWS);
+    if (num_bands < 2) {
+        return -1;
+    }
+
+    info = src->map->info;
+    info.src = (Uint8 *)src->pixels + sr.y * src->pitch + sr.x * info.src_fmt->BytesPerPixel;
+    info.src_w = sr.w;
+    info.src_h = sr.h;
+    info.src_pitch = src->pitch;
+    info.src_skip = info.src_pitch - info.src_w * info.src_fmt->BytesPerPixel;
+    info.dst = (Uint8 *)surface->pixels + dr.y * surface->pitch + dr.x * info.dst_fmt->BytesPerPixel;
+    info.dst_w = dr.w;
+    info.dst_h = dr.h;
+    info.dst_pitch = surface->pitch;
+    info.dst_skip = info.dst_pitch - info.dst_w * info.dst_fmt->BytesPerPixel;
+
+    job.blit = (SDL_BlitFunc)src->map->data;
+    job.info = &info;
+    SW_DispatchBands(data->pool, SW_BlitBand, &job, num_bands);
+    return 0;
+}
+
 static SDL_Surface *SW_ActivateRenderer(SDL_Renderer *renderer)
 {
     SW_RenderData *data = (SW_RenderData *)renderer->driverdata;
@@ -800,7 +1042,9 @@ static int SW_RunCommandQueue(SDL_Renderer *renderer, SDL_RenderCommand *cmd, vo
                 }
 
                 if ( srcrect->w == dstrect->w && srcrect->h == dstrect->h ) {
-                    SDL_BlitSurface(src, srcrect, surface, dstrect);
+                    if (SW_BlitSurfaceBands((SW_RenderData *)renderer->driverdata, src, srcrect, surface, dstrect) < 0) {
+                        SDL_BlitSurface(src, srcrect, surface, dstrect);
+                    }
                 } else {
                     /* If scaling is ever done, permanently disable RLE (which doesn't support scaling)
                      * to avoid potentially frequent RLE encoding/decoding.
@@ -982,6 +1226,9 @@ static void SW_DestroyRenderer(SDL_Renderer *renderer)
 {
     SW_RenderData *data = (SW_RenderData *)renderer->driverdata;
 
+    if (data) {
+        SW_DestroyBandPool(data->pool);
+    }
     SDL_free(data);
     SDL_free(renderer);
 }
@@ -687,6 +687,226 @@ void rgb24_yuv420_sseu(uint32_t width, uint32_t height,
 
 #endif //__SSE2__
 
+#ifdef YUV_RGB_HAVE_AVX
+
+#define AVX2_FUNCTION_NAME	yuv420_rgb565_avx2
+#define STD_FUNCTION_NAME	yuv420_rgb565_std
+#define YUV_FORMAT			YUV_FORMAT_420
+#define RGB_FORMAT			RGB_FORMAT_RGB565
+#include "yuv_rgb_avx2_func.h"
+
+#define AVX2_FUNCTION_NAME	yuv420_rgb24_avx2
+#define STD_FUNCTION_NAME	yuv420_rgb24_std
+#define YUV_FORMAT			YUV_FORMAT_420
+#define RGB_FORMAT			RGB_FORMAT_RGB24
+#include "yuv_rgb_avx2_func.h"
+
+#define AVX2_FUNCTION_NAME	yuv420_rgba_avx2
+#define STD_FUNCTION_NAME	yuv420_rgba_std
+#define YUV_FORMAT			YUV_FORMAT_420
+#define RGB_FORMAT			RGB_FORMAT_RGBA
+#include "yuv_rgb_avx2_func.h"
+
+#define AVX2_FUNCTION_NAME	yuv420_bgra_avx2
+#define STD_FUNCTION_NAME	yuv420_bgra_std
+#define YUV_FORMAT			YUV_FORMAT_420
+#define RGB_FORMAT			RGB_FORMAT_BGRA
+#include "yuv_rgb_avx2_func.h"
+
+#define AVX2_FUNCTION_NAME	yuv420_argb_avx2
+#define STD_FUNCTION_NAME	yuv420_argb_std
+#define YUV_FORMAT			YUV_FORMAT_420
+#define RGB_FORMAT			RGB_FORMAT_ARGB
+#include "yuv_rgb_avx2_func.h"
+
+#define AVX2_FUNCTION_NAME	yuv420_abgr_avx2
+#define STD_FUNCTION_NAME	yuv420_abgr_std
+#define YUV_FORMAT			YUV_FORMAT_420
+#define RGB_FORMAT			RGB_FORMAT_ABGR
+#include "yuv_rgb_avx2_func.h"
+
+#define AVX2_FUNCTION_NAME	yuv422_rgb565_avx2
+#define STD_FUNCTION_NAME	yuv422_rgb565_std
+#define YUV_FORMAT			YUV_FORMAT_422
+#define RGB_FORMAT			RGB_FORMAT_RGB565
+#include "yuv_rgb_avx2_func.h"
+
+#define AVX2_FUNCTION_NAME	yuv422_rgb24_avx2
+#define STD_FUNCTION_NAME	yuv422_rgb24_std
+#define YUV_FORMAT			YUV_FORMAT_422
+#define RGB_FORMAT			RGB_FORMAT_RGB24
+#include "yuv_rgb_avx2_func.h"
+
+#define AVX2_FUNCTION_NAME	yuv422_rgba_avx2
+#define STD_FUNCTION_NAME	yuv422_rgba_std
+#define YUV_FORMAT			YUV_FORMAT_422
+#define RGB_FORMAT			RGB_FORMAT_RGBA
+#include "yuv_rgb_avx2_func.h"
+
+#define AVX2_FUNCTION_NAME	yuv422_bgra_avx2
+#define STD_FUNCTION_NAME	yuv422_bgra_std
+#define YUV_FORMAT			YUV_FORMAT_422
+#define RGB_FORMAT			RGB_FORMAT_BGRA
+#include "yuv_rgb_avx2_func.h"
+
+#define AVX2_FUNCTION_NAME	yuv422_argb_avx2
+#define STD_FUNCTION_NAME	yuv422_argb_std
+#define YUV_FORMAT			YUV_FORMAT_422
+#define RGB_FORMAT			RGB_FORMAT_ARGB
+#include "yuv_rgb_avx2_func.h"
+
+#define AVX2_FUNCTION_NAME	yuv422_abgr_avx2
+#define STD_FUNCTION_NAME	yuv422_abgr_std
+#define YUV_FORMAT			YUV_FORMAT_422
+#define RGB_FORMAT			RGB_FORMAT_ABGR
+#include "yuv_rgb_avx2_func.h"
+
+#define AVX2_FUNCTION_NAME	yuvnv12_rgb565_avx2
+#define STD_FUNCTION_NAME	yuvnv12_rgb565_std
+#define YUV_FORMAT			YUV_FORMAT_NV12
+#define RGB_FORMAT			RGB_FORMAT_RGB565
+#include "yuv_rgb_avx2_func.h"
+
+#define AVX2_FUNCTION_NAME	yuvnv12_rgb24_avx2
+#define STD_FUNCTION_NAME	yuvnv12_rgb24_std
+#define YUV_FORMAT			YUV_FORMAT_NV12
+#define RGB_FORMAT			RGB_FORMAT_RGB24
+#include "yuv_rgb_avx2_func.h"
+
+#define AVX2_FUNCTION_NAME	yuvnv12_rgba_avx2
+#define STD_FUNCTION_NAME	yuvnv12_rgba_std
+#define YUV_FORMAT			YUV_FORMAT_NV12
+#define RGB_FORMAT			RGB_FORMAT_RGBA
+#include "yuv_rgb_avx2_func.h"
+
+#define AVX2_FUNCTION_NAME	yuvnv12_bgra_avx2
+#define STD_FUNCTION_NAME	yuvnv12_bgra_std
+#define YUV_FORMAT			YUV_FORMAT_NV12
+#define RGB_FORMAT			RGB_FORMAT_BGRA
+#include "yuv_rgb_avx2_func.h"
+
+#define AVX2_FUNCTION_NAME	yuvnv12_argb_avx2
+#define STD_FUNCTION_NAME	yuvnv12_argb_std
+#define YUV_FORMAT			YUV_FORMAT_NV12
+#define RGB_FORMAT			RGB_FORMAT_ARGB
+#include "yuv_rgb_avx2_func.h"
+
+#define AVX2_FUNCTION_NAME	yuvnv12_abgr_avx2
+#define STD_FUNCTION_NAME	yuvnv12_abgr_std
+#define YUV_FORMAT			YUV_FORMAT_NV12
+#define RGB_FORMAT			RGB_FORMAT_ABGR
+#include "yuv_rgb_avx2_func.h"
+
+#define AVX512_FUNCTION_NAME	yuv420_rgb565_avx512
+#define STD_FUNCTION_NAME	yuv420_rgb565_std
+#define YUV_FORMAT			YUV_FORMAT_420
+#define RGB_FORMAT			RGB_FORMAT_RGB565
+#include "yuv_rgb_avx512_func.h"
+
+#define AVX512_FUNCTION_NAME	yuv420_rgb24_avx512
+#define STD_FUNCTION_NAME	yuv420_rgb24_std
+#define YUV_FORMAT			YUV_FORMAT_420
+#define RGB_FORMAT			RGB_FORMAT_RGB24
+#include "yuv_rgb_avx512_func.h"
+
+#define AVX512_FUNCTION_NAME	yuv420_rgba_avx512
+#define STD_FUNCTION_NAME	yuv420_rgba_std
+#define YUV_FORMAT			YUV_FORMAT_420
+#define RGB_FORMAT			RGB_FORMAT_RGBA
+#include "yuv_rgb_avx512_func.h"
+
+#define AVX512_FUNCTION_NAME	yuv420_bgra_avx512
+#define STD_FUNCTION_NAME	yuv420_bgra_std
+#define YUV_FORMAT			YUV_FORMAT_420
+#define RGB_FORMAT			RGB_FORMAT_BGRA
+#include "yuv_rgb_avx512_func.h"
+
+#define AVX512_FUNCTION_NAME	yuv420_argb_avx512
+#define STD_FUNCTION_NAME	yuv420_argb_std
+#define YUV_FORMAT			YUV_FORMAT_420
+#define RGB_FORMAT			RGB_FORMAT_ARGB
+#include "yuv_rgb_avx512_func.h"
+
+#define AVX512_FUNCTION_NAME	yuv420_abgr_avx512
+#define STD_FUNCTION_NAME	yuv420_abgr_std
+#define YUV_FORMAT			YUV_FORMAT_420
+#define RGB_FORMAT			RGB_FORMAT_ABGR
+#include "yuv_rgb_avx512_func.h"
+
+#define AVX512_FUNCTION_NAME	yuv422_rgb565_avx512
+#define STD_FUNCTION_NAME	yuv422_rgb565_std
+#define YUV_FORMAT			YUV_FORMAT_422
+#define RGB_FORMAT			RGB_FORMAT_RGB565
+#include "yuv_rgb_avx512_func.h"
+
+#define AVX512_FUNCTION_NAME	yuv422_rgb24_avx512
+#define STD_FUNCTION_NAME	yuv422_rgb24_std
+#define YUV_FORMAT			YUV_FORMAT_422
+#define RGB_FORMAT			RGB_FORMAT_RGB24
+#include "yuv_rgb_avx512_func.h"
+
+#define AVX512_FUNCTION_NAME	yuv422_rgba_avx512
+#define STD_FUNCTION_NAME	yuv422_rgba_std
+#define YUV_FORMAT			YUV_FORMAT_422
+#define RGB_FORMAT			RGB_FORMAT_RGBA
+#include "yuv_rgb_avx512_func.h"
+
+#define AVX512_FUNCTION_NAME	yuv422_bgra_avx512
+#define STD_FUNCTION_NAME	yuv422_bgra_std
+#define YUV_FORMAT			YUV_FORMAT_422
+#define RGB_FORMAT			RGB_FORMAT_BGRA
+#include "yuv_rgb_avx512_func.h"
+
+#define AVX512_FUNCTION_NAME	yuv422_argb_avx512
+#define STD_FUNCTION_NAME	yuv422_argb_std
+#define YUV_FORMAT			YUV_FORMAT_422
+#define RGB_FORMAT			RGB_FORMAT_ARGB
+#include "yuv_rgb_avx512_func.h"
+
+#define AVX512_FUNCTION_NAME	yuv422_abgr_avx512
+#define STD_FUNCTION_NAME	yuv422_abgr_std
+#define YUV_FORMAT			YUV_FORMAT_422
+#define RGB_FORMAT			RGB_FORMAT_ABGR
+#include "yuv_rgb_avx512_func.h"
+
+#define AVX512_FUNCTION_NAME	yuvnv12_rgb565_avx512
+#define STD_FUNCTION_NAME	yuvnv12_rgb565_std
+#define YUV_FORMAT			YUV_FORMAT_NV12
+#define RGB_FORMAT			RGB_FORMAT_RGB565
+#include "yuv_rgb_avx512_func.h"
+
+#define AVX512_FUNCTION_NAME	yuvnv12_rgb24_avx512
+#define STD_FUNCTION_NAME	yuvnv12_rgb24_std
+#define YUV_FORMAT			YUV_FORMAT_NV12
+#define RGB_FORMAT			RGB_FORMAT_RGB24
+#include "yuv_rgb_avx512_func.h"
+
+#define AVX512_FUNCTION_NAME	yuvnv12_rgba_avx512
+#define STD_FUNCTION_NAME	yuvnv12_rgba_std
+#define YUV_FORMAT			YUV_FORMAT_NV12
+#define RGB_FORMAT			RGB_FORMAT_RGBA
+#include "yuv_rgb_avx512_func.h"
+
+#define AVX512_FUNCTION_NAME	yuvnv12_bgra_avx512
+#define STD_FUNCTION_NAME	yuvnv12_bgra_std
+#define YUV_FORMAT			YUV_FORMAT_NV12
+#define RGB_FORMAT			RGB_FORMAT_BGRA
+#include "yuv_rgb_avx512_func.h"
+
+#define AVX512_FUNCTION_NAME	yuvnv12_argb_avx512
+#define STD_FUNCTION_NAME	yuvnv12_argb_std
+#define YUV_FORMAT			YUV_FORMAT_NV12
+#define RGB_FORMAT			RGB_FORMAT_ARGB
+#include "yuv_rgb_avx512_func.h"
+
+#define AVX512_FUNCTION_NAME	yuvnv12_abgr_avx512
+#define STD_FUNCTION_NAME	yuvnv12_abgr_std
+#define YUV_FORMAT			YUV_FORMAT_NV12
+#define RGB_FORMAT			RGB_FORMAT_ABGR
+#include "yuv_rgb_avx512_func.h"
+
+#endif //YUV_RGB_HAVE_AVX
+
 #ifdef __loongarch_sx
 
 #define LSX_FUNCTION_NAME	yuv420_rgb24_lsx
@@ -0,0 +1,321 @@
+// Copyright 2016 Adrien Descamps
+// Distributed under BSD 3-Clause License
+
+/* You need to define the following macros before including this file:
+	AVX2_FUNCTION_NAME
+	STD_FUNCTION_NAME
+	YUV_FORMAT
+	RGB_FORMAT
+*/
+
+/* AVX2 version of yuv_rgb_sse_func.h, 32 pixels of two lines per iteration.
+ * The arithmetic is the same 16 bit fixed point, so the output is bit exact with the sse version.
+ * AVX2 pack/unpack work inside 128 bit lanes, PERMUTE_LANES puts the 64 bit quarters back in pixel order
+ * around them.
+ * Reads span the same bytes as the sse version, so the same last line / last column workarounds apply.
+ */
+
+#ifndef YUV_RGB_AVX2_HELPERS
+#define YUV_RGB_AVX2_HELPERS
+
+#define PERMUTE_LANES(x) _mm256_permute4x64_epi64(x, 0xD8)
+
+/* c0..c3 hold byte 0..3 of 32 consecutive 32 bit pixels, in pixel order */
+static YUV_RGB_TARGET("avx2") void avx2_save_32bpp(uint8_t *rgb_ptr, __m256i c0, __m256i c1, __m256i c2, __m256i c3)
+{
+	__m256i lo01, hi01, lo23, hi23;
+
+	c0 = PERMUTE_LANES(c0);
+	c1 = PERMUTE_LANES(c1);
+	c2 = PERMUTE_LANES(c2);
+	c3 = PERMUTE_LANES(c3);
+	lo01 = PERMUTE_LANES(_mm256_unpacklo_epi8(c0, c1));
+	hi01 = PERMUTE_LANES(_mm256_unpackhi_epi8(c0, c1));
+	lo23 = PERMUTE_LANES(_mm256_unpacklo_epi8(c2, c3));
+	hi23 = PERMUTE_LANES(_mm256_unpackhi_epi8(c2, c3));
+
+	_mm256_storeu_si256((__m256i*)(rgb_ptr), _mm256_unpacklo_epi16(lo01, lo23));
+	_mm256_storeu_si256((__m256i*)(rgb_ptr+32), _mm256_unpackhi_epi16(lo01, lo23));
+	_mm256_storeu_si256((__m256i*)(rgb_ptr+64), _mm256_unpacklo_epi16(hi01, hi23));
+	_mm256_storeu_si256((__m256i*)(rgb_ptr+96), _mm256_unpackhi_epi16(hi01, hi23));
+}
+
+/* r, g, b hold 16 pixels, interleave them into 48 bytes of rgb24 */
+static YUV_RGB_TARGET("ssse3") void save_rgb24_16(uint8_t *rgb_ptr, __m128i r, __m128i g, __m128i b)
+{
+	const __m128i r0 = _mm_setr_epi8(0,-1,-1,1,-1,-1,2,-1,-1,3,-1,-1,4,-1,-1,5);
+	const __m128i g0 = _mm_setr_epi8(-1,0,-1,-1,1,-1,-1,2,-1,-1,3,-1,-1,4,-1,-1);
+	const __m128i b0 = _mm_setr_epi8(-1,-1,0,-1,-1,1,-1,-1,2,-1,-1,3,-1,-1,4,-1);
+	const __m128i r1 = _mm_setr_epi8(-1,-1,6,-1,-1,7,-1,-1,8,-1,-1,9,-1,-1,10,-1);
+	const __m128i g1 = _mm_setr_epi8(5,-1,-1,6,-1,-1,7,-1,-1,8,-1,-1,9,-1,-1,10);
+	const __m128i b1 = _mm_setr_epi8(-1,5,-1,-1,6,-1,-1,7,-1,-1,8,-1,-1,9,-1,-1);
+	const __m128i r2 = _mm_setr_epi8(-1,11,-1,-1,12,-1,-1,13,-1,-1,14,-1,-1,15,-1,-1);
+	const __m128i g2 = _mm_setr_epi8(-1,-1,11,-1,-1,12,-1,-1,13,-1,-1,14,-1,-1,15,-1);
+	const __m128i b2 = _mm_setr_epi8(10,-1,-1,11,-1,-1,12,-1,-1,13,-1,-1,14,-1,-1,15);
+
+	_mm_storeu_si128((__m128i*)(rgb_ptr), _mm_or_si128(_mm_or_si128(
+		_mm_shuffle_epi8(r, r0), _mm_shuffle_epi8(g, g0)), _mm_shuffle_epi8(b, b0)));
+	_mm_storeu_si128((__m128i*)(rgb_ptr+16), _mm_or_si128(_mm_or_si128(
+		_mm_shuffle_epi8(r, r1), _mm_shuffle_epi8(g, g1)), _mm_shuffle_epi8(b, b1)));
+	_mm_storeu_si128((__m128i*)(rgb_ptr+32), _mm_or_si128(_mm_or_si128(
+		_mm_shuffle_epi8(r, r2), _mm_shuffle_epi8(g, g2)), _mm_shuffle_epi8(b, b2)));
+}
+
+#endif /* YUV_RGB_AVX2_HELPERS */
+
+#if YUV_FORMAT == YUV_FORMAT_420
+
+#define READ_Y(y_ptr) \
+	y_16_1 = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(y_ptr))); \
+	y_16_2 = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(y_ptr+16))); \
+
+#define READ_UV \
+	u_16 = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(u_ptr))); \
+	v_16 = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(v_ptr))); \
+
+#elif YUV_FORMAT == YUV_FORMAT_422
+
+#define READ_Y(y_ptr) \
+	y_16_1 = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)(y_ptr)), _mm256_set1_epi16(0xFF)); \
+	y_16_2 = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)(y_ptr+32)), _mm256_set1_epi16(0xFF)); \
+
+#define READ_UV \
+	u_16 = PERMUTE_LANES(_mm256_packs_epi32( \
+		_mm256_and_si256(_mm256_loadu_si256((const __m256i*)(u_ptr)), _mm256_set1_epi32(0xFF)), \
+		_mm256_and_si256(_mm256_loadu_si256((const __m256i*)(u_ptr+32)), _mm256_set1_epi32(0xFF)))); \
+	v_16 = PERMUTE_LANES(_mm256_packs_epi32( \
+		_mm256_and_si256(_mm256_loadu_si256((const __m256i*)(v_ptr)), _mm256_set1_epi32(0xFF)), \
+		_mm256_and_si256(_mm256_loadu_si256((const __m256i*)(v_ptr+32)), _mm256_set1_epi32(0xFF)))); \
+
+#elif YUV_FORMAT == YUV_FORMAT_NV12
+
+#define READ_Y(y_ptr) \
+	y_16_1 = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(y_ptr))); \
+	y_16_2 = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(y_ptr+16))); \
+
+#define READ_UV \
+	u_16 = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)(u_ptr)), _mm256_set1_epi16(0xFF)); \
+	v_16 = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)(v_ptr)), _mm256_set1_epi16(0xFF)); \
+
+#else
+#error READ_UV unimplemented
+#endif
+
+/* 16 bit r, g, b of 32 pixels of one line, unclamped */
+#define ADD_Y2RGB_32(y_ptr) \
+	READ_Y(y_ptr) \
+	y_16_1 = _mm256_mullo_epi16(_mm256_sub_epi16(y_16_1, _mm256_set1_epi16(param->y_shift)), _mm256_set1_epi16(param->y_factor)); \
+	y_16_2 = _mm256_mullo_epi16(_mm256_sub_epi16(y_16_2, _mm256_set1_epi16(param->y_shift)), _mm256_set1_epi16(param->y_factor)); \
+	r_16_1 = _mm256_srai_epi16(_mm256_add_epi16(r_uv_16_1, y_16_1), PRECISION); \
+	g_16_1 = _mm256_srai_epi16(_mm256_add_epi16(g_uv_16_1, y_16_1), PRECISION); \
+	b_16_1 = _mm256_srai_epi16(_mm256_add_epi16(b_uv_16_1, y_16_1), PRECISION); \
+	r_16_2 = _mm256_srai_epi16(_mm256_add_epi16(r_uv_16_2, y_16_2), PRECISION); \
+	g_16_2 = _mm256_srai_epi16(_mm256_add_epi16(g_uv_16_2, y_16_2), PRECISION); \
+	b_16_2 = _mm256_srai_epi16(_mm256_add_epi16(b_uv_16_2, y_16_2), PRECISION); \
+
+#define PACK_8(X) PERMUTE_LANES(_mm256_packus_epi16(X##_16_1, X##_16_2))
+#define CLAMP_16(X) _mm256_min_epi16(_mm256_max_epi16(X, _mm256_setzero_si256()), _mm256_set1_epi16(0xFF))
+
+#if RGB_FORMAT == RGB_FORMAT_RGB565
+
+#define RGB565_16(R, G, B) \
+	_mm256_or_si256(_mm256_or_si256( \
+		_mm256_slli_epi16(_mm256_and_si256(CLAMP_16(R), _mm256_set1_epi16(0xF8)), 8), \
+		_mm256_slli_epi16(_mm256_and_si256(CLAMP_16(G), _mm256_set1_epi16(0xFC)), 3)), \
+		_mm256_srli_epi16(CLAMP_16(B), 3))
+
+#define SAVE_LINE(rgb_ptr) \
+	_mm256_storeu_si256((__m256i*)(rgb_ptr), RGB565_16(r_16_1, g_16_1, b_16_1)); \
+	_mm256_storeu_si256((__m256i*)(rgb_ptr+32), RGB565_16(r_16_2, g_16_2, b_16_2)); \
+
+#elif RGB_FORMAT == RGB_FORMAT_RGB24
+
+#define SAVE_LINE(rgb_ptr) \
+{ \
+	__m256i r_8 = PACK_8(r), g_8 = PACK_8(g), b_8 = PACK_8(b); \
+	save_rgb24_16(rgb_ptr, _mm256_castsi256_si128(r_8), _mm256_castsi256_si128(g_8), _mm256_castsi256_si128(b_8)); \
+	save_rgb24_16(rgb_ptr+48, _mm256_extracti128_si256(r_8, 1), _mm256_extracti128_si256(g_8, 1), _mm256_extracti128_si256(b_8, 1)); \
+}
+
+#elif RGB_FORMAT == RGB_FORMAT_RGBA
+
+#define SAVE_LINE(rgb_ptr) \
+	avx2_save_32bpp(rgb_ptr, _mm256_set1_epi8((char)0xFF), PACK_8(b), PACK_8(g), PACK_8(r)); \
+
+#elif RGB_FORMAT == RGB_FORMAT_BGRA
+
+#define SAVE_LINE(rgb_ptr) \
+	avx2_save_32bpp(rgb_ptr, _mm256_set1_epi8((char)0xFF), PACK_8(r), PACK_8(g), PACK_8(b)); \
+
+#elif RGB_FORMAT == RGB_FORMAT_ARGB
+
+#define SAVE_LINE(rgb_ptr) \
+	avx2_save_32bpp(rgb_ptr, PACK_8(b), PACK_8(g), PACK_8(r), _mm256_set1_epi8((char)0xFF)); \
+
+#elif RGB_FORMAT == RGB_FORMAT_ABGR
+
+#define SAVE_LINE(rgb_ptr) \
+	avx2_save_32bpp(rgb_ptr, PACK_8(r), PACK_8(g), PACK_8(b), _mm256_set1_epi8((char)0xFF)); \
+
+#else
+#error SAVE_LINE unimplemented
+#endif
+
+#define YUV2RGB_32 \
+	__m256i u_16, v_16, y_16_1, y_16_2; \
+	__m256i r_uv_16, g_uv_16, b_uv_16; \
+	__m256i r_uv_16_1, g_uv_16_1, b_uv_16_1, r_uv_16_2, g_uv_16_2, b_uv_16_2; \
+	__m256i r_16_1, g_16_1, b_16_1, r_16_2, g_16_2, b_16_2; \
+	\
+	READ_UV \
+	u_16 = _mm256_add_epi16(u_16, _mm256_set1_epi16(-128)); \
+	v_16 = _mm256_add_epi16(v_16, _mm256_set1_epi16(-128)); \
+	\
+	/* chroma terms of 16 samples, each doubled for its two pixels */ \
+	r_uv_16 = PERMUTE_LANES(_mm256_mullo_epi16(v_16, _mm256_set1_epi16(param->v_r_factor))); \
+	g_uv_16 = PERMUTE_LANES(_mm256_add_epi16( \
+		_mm256_mullo_epi16(u_16, _mm256_set1_epi16(param->u_g_factor)), \
+		_mm256_mullo_epi16(v_16, _mm256_set1_epi16(param->v_g_factor)))); \
+	b_uv_16 = PERMUTE_LANES(_mm256_mullo_epi16(u_16, _mm256_set1_epi16(param->u_b_factor))); \
+	r_uv_16_1 = _mm256_unpacklo_epi16(r_uv_16, r_uv_16); \
+	g_uv_16_1 = _mm256_unpacklo_epi16(g_uv_16, g_uv_16); \
+	b_uv_16_1 = _mm256_unpacklo_epi16(b_uv_16, b_uv_16); \
+	r_uv_16_2 = _mm256_unpackhi_epi16(r_uv_16, r_uv_16); \
+	g_uv_16_2 = _mm256_unpackhi_epi16(g_uv_16, g_uv_16); \
+	b_uv_16_2 = _mm256_unpackhi_epi16(b_uv_16, b_uv_16); \
+	\
+	ADD_Y2RGB_32(y_ptr1) \
+	SAVE_LINE(rgb_ptr1) \
+	if (uv_y_sample_interval > 1) \
+	{ \
+		ADD_Y2RGB_32(y_ptr2) \
+		SAVE_LINE(rgb_ptr2) \
+	} \
+
+
+YUV_RGB_TARGET("avx2") void AVX2_FUNCTION_NAME(uint32_t width, uint32_t height,
+	const uint8_t *Y, const uint8_t *U, const uint8_t *V, uint32_t Y_stride, uint32_t UV_stride,
+	uint8_t *RGB, uint32_t RGB_stride,
+	YCbCrType yuv_type)
+{
+	const YUV2RGBParam *const param = &(YUV2RGB[yuv_type]);
+#if YUV_FORMAT == YUV_FORMAT_420
+	const int y_pixel_stride = 1;
+	const int uv_pixel_stride = 1;
+	const int uv_x_sample_interval = 2;
+	const int uv_y_sample_interval = 2;
+#elif YUV_FORMAT == YUV_FORMAT_422
+	const int y_pixel_stride = 2;
+	const int uv_pixel_stride = 4;
+	const int uv_x_sample_interval = 2;
+	const int uv_y_sample_interval = 1;
+#elif YUV_FORMAT == YUV_FORMAT_NV12
+	const int y_pixel_stride = 1;
+	const int uv_pixel_stride = 2;
+	const int uv_x_sample_interval = 2;
+	const int uv_y_sample_interval = 2;
+#endif
+#if RGB_FORMAT == RGB_FORMAT_RGB565
+	const int rgb_pixel_stride = 2;
+#elif RGB_FORMAT == RGB_FORMAT_RGB24
+	const int rgb_pixel_stride = 3;
+#elif RGB_FORMAT == RGB_FORMAT_RGBA || RGB_FORMAT == RGB_FORMAT_BGRA || \
+      RGB_FORMAT == RGB_FORMAT_ARGB || RGB_FORMAT == RGB_FORMAT_ABGR
+	const int rgb_pixel_stride = 4;
+#else
+#error Unknown RGB pixel size
+#endif
+
+#if YUV_FORMAT == YUV_FORMAT_NV12
+	/* the V read runs one byte past the last pixel, see yuv_rgb_sse_func.h */
+	const int fix_read_nv12 = ((width & 31) == 0);
+#else
+	const int fix_read_nv12 = 0;
+#endif
+
+#if YUV_FORMAT == YUV_FORMAT_422
+	/* Avoid invalid read on last line */
+	const int fix_read_422 = 1;
+#else
+	const int fix_read_422 = 0;
+#endif
+
+
+	if (width >= 32) {
+		uint32_t xpos, ypos;
+		for(ypos=0; ypos<(height-(uv_y_sample_interval-1)) - fix_read_422; ypos+=uv_y_sample_interval)
+		{
+			const uint8_t *y_ptr1=Y+ypos*Y_stride,
+				*y_ptr2=Y+(ypos+1)*Y_stride,
+				*u_ptr=U+(ypos/uv_y_sample_interval)*UV_stride,
+				*v_ptr=V+(ypos/uv_y_sample_interval)*UV_stride;
+
+			uint8_t *rgb_ptr1=RGB+ypos*RGB_stride,
+				*rgb_ptr2=RGB+(ypos+1)*RGB_stride;
+
+			for(xpos=0; xpos<(width-31) - fix_read_nv12; xpos+=32)
+			{
+				YUV2RGB_32
+
+				y_ptr1+=32*y_pixel_stride;
+				y_ptr2+=32*y_pixel_stride;
+				u_ptr+=32*uv_pixel_stride/uv_x_sample_interval;
+				v_ptr+=32*uv_pixel_stride/uv_x_sample_interval;
+				rgb_ptr1+=32*rgb_pixel_stride;
+				rgb_ptr2+=32*rgb_pixel_stride;
+			}
+		}
+
+		if (fix_read_422) {
+			const uint8_t *y_ptr=Y+ypos*Y_stride,
+				*u_ptr=U+(ypos/uv_y_sample_interval)*UV_stride,
+				*v_ptr=V+(ypos/uv_y_sample_interval)*UV_stride;
+			uint8_t *rgb_ptr=RGB+ypos*RGB_stride;
+			STD_FUNCTION_NAME(width, 1, y_ptr, u_ptr, v_ptr, Y_stride, UV_stride, rgb_ptr, RGB_stride, yuv_type);
+			ypos += uv_y_sample_interval;
+		}
+
+		/* Catch the last line, if needed */
+		if (uv_y_sample_interval == 2 && ypos == (height-1))
+		{
+			const uint8_t *y_ptr=Y+ypos*Y_stride,
+				*u_ptr=U+(ypos/uv_y_sample_interval)*UV_stride,
+				*v_ptr=V+(ypos/uv_y_sample_interval)*UV_stride;
+
+			uint8_t *rgb_ptr=RGB+ypos*RGB_stride;
+
+			STD_FUNCTION_NAME(width, 1, y_ptr, u_ptr, v_ptr, Y_stride, UV_stride, rgb_ptr, RGB_stride, yuv_type);
+		}
+	}
+
+	/* Catch the right column, if needed */
+	{
+		int converted = (width & ~31);
+		if (fix_read_nv12) {
+			converted -= 32;
+		}
+		if (converted != width)
+		{
+			const uint8_t *y_ptr=Y+converted*y_pixel_stride,
+				*u_ptr=U+converted*uv_pixel_stride/uv_x_sample_interval,
+				*v_ptr=V+converted*uv_pixel_stride/uv_x_sample_interval;
+
+			uint8_t *rgb_ptr=RGB+converted*rgb_pixel_stride;
+
+			STD_FUNCTION_NAME(width-converted, height, y_ptr, u_ptr, v_ptr, Y_stride, UV_stride, rgb_ptr, RGB_stride, yuv_type);
+		}
+	}
+}
+
+#undef AVX2_FUNCTION_NAME
+#undef STD_FUNCTION_NAME
+#undef YUV_FORMAT
+#undef RGB_FORMAT
+#undef READ_Y
+#undef READ_UV
+#undef ADD_Y2RGB_32
+#undef PACK_8
+#undef CLAMP_16
+#undef RGB565_16
+#undef SAVE_LINE
+#undef YUV2RGB_32
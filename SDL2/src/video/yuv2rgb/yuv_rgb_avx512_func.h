@@ -0,0 +1,274 @@
+// Copyright 2016 Adrien Descamps
+// Distributed under BSD 3-Clause License
+
+/* You need to define the following macros before including this file:
+	AVX512_FUNCTION_NAME
+	STD_FUNCTION_NAME
+	YUV_FORMAT
+	RGB_FORMAT
+*/
+
+/* AVX-512F version of yuv_rgb_sse_func.h, 32 pixels of two lines per iteration.
+ * AVX-512F alone has no 16 bit arithmetic, so this works on 32 bit lanes, 16 pixels per vector.
+ * In range input gives the same output as the sse version. Far out of range chroma saturates
+ * here, where the 16 bit sums of the sse version wrap.
+ * Working in 32 bit lanes also means pixels are assembled with shifts instead of byte unpacks.
+ * Reads span the same bytes as the sse version, so the same last line / last column workarounds apply.
+ * Include yuv_rgb_avx2_func.h first, the rgb24 interleave is shared with it.
+ */
+
+#ifndef YUV_RGB_AVX512_HELPERS
+#define YUV_RGB_AVX512_HELPERS
+
+#define CLAMP_32(X) _mm512_min_epi32(_mm512_max_epi32(X, _mm512_setzero_si512()), _mm512_set1_epi32(0xFF))
+
+#endif /* YUV_RGB_AVX512_HELPERS */
+
+#if YUV_FORMAT == YUV_FORMAT_420
+
+#define READ_Y(y_ptr) \
+	y_32_1 = _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i*)(y_ptr))); \
+	y_32_2 = _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i*)(y_ptr+16))); \
+
+#define READ_UV \
+	u_32 = _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i*)(u_ptr))); \
+	v_32 = _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i*)(v_ptr))); \
+
+#elif YUV_FORMAT == YUV_FORMAT_422
+
+#define READ_Y(y_ptr) \
+	y_32_1 = _mm512_and_si512(_mm512_cvtepu16_epi32(_mm256_loadu_si256((const __m256i*)(y_ptr))), _mm512_set1_epi32(0xFF)); \
+	y_32_2 = _mm512_and_si512(_mm512_cvtepu16_epi32(_mm256_loadu_si256((const __m256i*)(y_ptr+32))), _mm512_set1_epi32(0xFF)); \
+
+#define READ_UV \
+	u_32 = _mm512_and_si512(_mm512_loadu_si512((const void*)(u_ptr)), _mm512_set1_epi32(0xFF)); \
+	v_32 = _mm512_and_si512(_mm512_loadu_si512((const void*)(v_ptr)), _mm512_set1_epi32(0xFF)); \
+
+#elif YUV_FORMAT == YUV_FORMAT_NV12
+
+#define READ_Y(y_ptr) \
+	y_32_1 = _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i*)(y_ptr))); \
+	y_32_2 = _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i*)(y_ptr+16))); \
+
+#define READ_UV \
+	u_32 = _mm512_and_si512(_mm512_cvtepu16_epi32(_mm256_loadu_si256((const __m256i*)(u_ptr))), _mm512_set1_epi32(0xFF)); \
+	v_32 = _mm512_and_si512(_mm512_cvtepu16_epi32(_mm256_loadu_si256((const __m256i*)(v_ptr))), _mm512_set1_epi32(0xFF)); \
+
+#else
+#error READ_UV unimplemented
+#endif
+
+/* clamped 32 bit r, g, b of 32 pixels of one line */
+#define ADD_Y2RGB_32(y_ptr) \
+	READ_Y(y_ptr) \
+	y_32_1 = _mm512_mullo_epi32(_mm512_sub_epi32(y_32_1, _mm512_set1_epi32(param->y_shift)), _mm512_set1_epi32(param->y_factor)); \
+	y_32_2 = _mm512_mullo_epi32(_mm512_sub_epi32(y_32_2, _mm512_set1_epi32(param->y_shift)), _mm512_set1_epi32(param->y_factor)); \
+	r_32_1 = CLAMP_32(_mm512_srai_epi32(_mm512_add_epi32(r_uv_32_1, y_32_1), PRECISION)); \
+	g_32_1 = CLAMP_32(_mm512_srai_epi32(_mm512_add_epi32(g_uv_32_1, y_32_1), PRECISION)); \
+	b_32_1 = CLAMP_32(_mm512_srai_epi32(_mm512_add_epi32(b_uv_32_1, y_32_1), PRECISION)); \
+	r_32_2 = CLAMP_32(_mm512_srai_epi32(_mm512_add_epi32(r_uv_32_2, y_32_2), PRECISION)); \
+	g_32_2 = CLAMP_32(_mm512_srai_epi32(_mm512_add_epi32(g_uv_32_2, y_32_2), PRECISION)); \
+	b_32_2 = CLAMP_32(_mm512_srai_epi32(_mm512_add_epi32(b_uv_32_2, y_32_2), PRECISION)); \
+
+#if RGB_FORMAT == RGB_FORMAT_RGB565
+
+#define RGB565_32(R, G, B) \
+	_mm512_cvtepi32_epi16(_mm512_or_si512(_mm512_or_si512( \
+		_mm512_slli_epi32(_mm512_and_si512(R, _mm512_set1_epi32(0xF8)), 8), \
+		_mm512_slli_epi32(_mm512_and_si512(G, _mm512_set1_epi32(0xFC)), 3)), \
+		_mm512_srli_epi32(B, 3)))
+
+#define SAVE_LINE(rgb_ptr) \
+	_mm256_storeu_si256((__m256i*)(rgb_ptr), RGB565_32(r_32_1, g_32_1, b_32_1)); \
+	_mm256_storeu_si256((__m256i*)(rgb_ptr+32), RGB565_32(r_32_2, g_32_2, b_32_2)); \
+
+#elif RGB_FORMAT == RGB_FORMAT_RGB24
+
+#define SAVE_LINE(rgb_ptr) \
+	save_rgb24_16(rgb_ptr, _mm512_cvtepi32_epi8(r_32_1), _mm512_cvtepi32_epi8(g_32_1), _mm512_cvtepi32_epi8(b_32_1)); \
+	save_rgb24_16(rgb_ptr+48, _mm512_cvtepi32_epi8(r_32_2), _mm512_cvtepi32_epi8(g_32_2), _mm512_cvtepi32_epi8(b_32_2)); \
+
+#else
+
+/* byte 0..3 of the stored pixel, alpha is OR'ed in as a constant */
+#if RGB_FORMAT == RGB_FORMAT_RGBA
+#define PACK_32BPP(R, G, B) _mm512_or_si512(_mm512_or_si512(_mm512_set1_epi32(0xFF), _mm512_slli_epi32(B, 8)), \
+	_mm512_or_si512(_mm512_slli_epi32(G, 16), _mm512_slli_epi32(R, 24)))
+#elif RGB_FORMAT == RGB_FORMAT_BGRA
+#define PACK_32BPP(R, G, B) _mm512_or_si512(_mm512_or_si512(_mm512_set1_epi32(0xFF), _mm512_slli_epi32(R, 8)), \
+	_mm512_or_si512(_mm512_slli_epi32(G, 16), _mm512_slli_epi32(B, 24)))
+#elif RGB_FORMAT == RGB_FORMAT_ARGB
+#define PACK_32BPP(R, G, B) _mm512_or_si512(_mm512_or_si512(B, _mm512_slli_epi32(G, 8)), \
+	_mm512_or_si512(_mm512_slli_epi32(R, 16), _mm512_set1_epi32((int)0xFF000000)))
+#elif RGB_FORMAT == RGB_FORMAT_ABGR
+#define PACK_32BPP(R, G, B) _mm512_or_si512(_mm512_or_si512(R, _mm512_slli_epi32(G, 8)), \
+	_mm512_or_si512(_mm512_slli_epi32(B, 16), _mm512_set1_epi32((int)0xFF000000)))
+#else
+#error SAVE_LINE unimplemented
+#endif
+
+#define SAVE_LINE(rgb_ptr) \
+	_mm512_storeu_si512((void*)(rgb_ptr), PACK_32BPP(r_32_1, g_32_1, b_32_1)); \
+	_mm512_storeu_si512((void*)(rgb_ptr+64), PACK_32BPP(r_32_2, g_32_2, b_32_2)); \
+
+#endif
+
+#define YUV2RGB_32 \
+	__m512i u_32, v_32, y_32_1, y_32_2; \
+	__m512i r_uv_32, g_uv_32, b_uv_32; \
+	__m512i r_uv_32_1, g_uv_32_1, b_uv_32_1, r_uv_32_2, g_uv_32_2, b_uv_32_2; \
+	__m512i r_32_1, g_32_1, b_32_1, r_32_2, g_32_2, b_32_2; \
+	\
+	READ_UV \
+	u_32 = _mm512_sub_epi32(u_32, _mm512_set1_epi32(128)); \
+	v_32 = _mm512_sub_epi32(v_32, _mm512_set1_epi32(128)); \
+	\
+	/* chroma terms of 16 samples, each doubled for its two pixels */ \
+	r_uv_32 = _mm512_mullo_epi32(v_32, _mm512_set1_epi32(param->v_r_factor)); \
+	g_uv_32 = _mm512_add_epi32( \
+		_mm512_mullo_epi32(u_32, _mm512_set1_epi32(param->u_g_factor)), \
+		_mm512_mullo_epi32(v_32, _mm512_set1_epi32(param->v_g_factor))); \
+	b_uv_32 = _mm512_mullo_epi32(u_32, _mm512_set1_epi32(param->u_b_factor)); \
+	r_uv_32_1 = _mm512_permutexvar_epi32(dup_lo, r_uv_32); \
+	g_uv_32_1 = _mm512_permutexvar_epi32(dup_lo, g_uv_32); \
+	b_uv_32_1 = _mm512_permutexvar_epi32(dup_lo, b_uv_32); \
+	r_uv_32_2 = _mm512_permutexvar_epi32(dup_hi, r_uv_32); \
+	g_uv_32_2 = _mm512_permutexvar_epi32(dup_hi, g_uv_32); \
+	b_uv_32_2 = _mm512_permutexvar_epi32(dup_hi, b_uv_32); \
+	\
+	ADD_Y2RGB_32(y_ptr1) \
+	SAVE_LINE(rgb_ptr1) \
+	if (uv_y_sample_interval > 1) \
+	{ \
+		ADD_Y2RGB_32(y_ptr2) \
+		SAVE_LINE(rgb_ptr2) \
+	} \
+
+
+YUV_RGB_TARGET("avx512f") void AVX512_FUNCTION_NAME(uint32_t width, uint32_t height,
+	const uint8_t *Y, const uint8_t *U, const uint8_t *V, uint32_t Y_stride, uint32_t UV_stride,
+	uint8_t *RGB, uint32_t RGB_stride,
+	YCbCrType yuv_type)
+{
+	const YUV2RGBParam *const param = &(YUV2RGB[yuv_type]);
+	const __m512i dup_lo = _mm512_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7);
+	const __m512i dup_hi = _mm512_setr_epi32(8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13, 14, 14, 15, 15);
+#if YUV_FORMAT == YUV_FORMAT_420
+	const int y_pixel_stride = 1;
+	const int uv_pixel_stride = 1;
+	const int uv_x_sample_interval = 2;
+	const int uv_y_sample_interval = 2;
+#elif YUV_FORMAT == YUV_FORMAT_422
+	const int y_pixel_stride = 2;
+	const int uv_pixel_stride = 4;
+	const int uv_x_sample_interval = 2;
+	const int uv_y_sample_interval = 1;
+#elif YUV_FORMAT == YUV_FORMAT_NV12
+	const int y_pixel_stride = 1;
+	const int uv_pixel_stride = 2;
+	const int uv_x_sample_interval = 2;
+	const int uv_y_sample_interval = 2;
+#endif
+#if RGB_FORMAT == RGB_FORMAT_RGB565
+	const int rgb_pixel_stride = 2;
+#elif RGB_FORMAT == RGB_FORMAT_RGB24
+	const int rgb_pixel_stride = 3;
+#elif RGB_FORMAT == RGB_FORMAT_RGBA || RGB_FORMAT == RGB_FORMAT_BGRA || \
+      RGB_FORMAT == RGB_FORMAT_ARGB || RGB_FORMAT == RGB_FORMAT_ABGR
+	const int rgb_pixel_stride = 4;
+#else
+#error Unknown RGB pixel size
+#endif
+
+#if YUV_FORMAT == YUV_FORMAT_NV12
+	/* the V read runs one byte past the last pixel, see yuv_rgb_sse_func.h */
+	const int fix_read_nv12 = ((width & 31) == 0);
+#else
+	const int fix_read_nv12 = 0;
+#endif
+
+#if YUV_FORMAT == YUV_FORMAT_422
+	/* Avoid invalid read on last line */
+	const int fix_read_422 = 1;
+#else
+	const int fix_read_422 = 0;
+#endif
+
+
+	if (width >= 32) {
+		uint32_t xpos, ypos;
+		for(ypos=0; ypos<(height-(uv_y_sample_interval-1)) - fix_read_422; ypos+=uv_y_sample_interval)
+		{
+			const uint8_t *y_ptr1=Y+ypos*Y_stride,
+				*y_ptr2=Y+(ypos+1)*Y_stride,
+				*u_ptr=U+(ypos/uv_y_sample_interval)*UV_stride,
+				*v_ptr=V+(ypos/uv_y_sample_interval)*UV_stride;
+
+			uint8_t *rgb_ptr1=RGB+ypos*RGB_stride,
+				*rgb_ptr2=RGB+(ypos+1)*RGB_stride;
+
+			for(xpos=0; xpos<(width-31) - fix_read_nv12; xpos+=32)
+			{
+				YUV2RGB_32
+
+				y_ptr1+=32*y_pixel_stride;
+				y_ptr2+=32*y_pixel_stride;
+				u_ptr+=32*uv_pixel_stride/uv_x_sample_interval;
+				v_ptr+=32*uv_pixel_stride/uv_x_sample_interval;
+				rgb_ptr1+=32*rgb_pixel_stride;
+				rgb_ptr2+=32*rgb_pixel_stride;
+			}
+		}
+
+		if (fix_read_422) {
+			const uint8_t *y_ptr=Y+ypos*Y_stride,
+				*u_ptr=U+(ypos/uv_y_sample_interval)*UV_stride,
+				*v_ptr=V+(ypos/uv_y_sample_interval)*UV_stride;
+			uint8_t *rgb_ptr=RGB+ypos*RGB_stride;
+			STD_FUNCTION_NAME(width, 1, y_ptr, u_ptr, v_ptr, Y_stride, UV_stride, rgb_ptr, RGB_stride, yuv_type);
+			ypos += uv_y_sample_interval;
+		}
+
+		/* Catch the last line, if needed */
+		if (uv_y_sample_interval == 2 && ypos == (height-1))
+		{
+			const uint8_t *y_ptr=Y+ypos*Y_stride,
+				*u_ptr=U+(ypos/uv_y_sample_interval)*UV_stride,
+				*v_ptr=V+(ypos/uv_y_sample_interval)*UV_stride;
+
+			uint8_t *rgb_ptr=RGB+ypos*RGB_stride;
+
+			STD_FUNCTION_NAME(width, 1, y_ptr, u_ptr, v_ptr, Y_stride, UV_stride, rgb_ptr, RGB_stride, yuv_type);
+		}
+	}
+
+	/* Catch the right column, if needed */
+	{
+		int converted = (width & ~31);
+		if (fix_read_nv12) {
+			converted -= 32;
+		}
+		if (converted != width)
+		{
+			const uint8_t *y_ptr=Y+converted*y_pixel_stride,
+				*u_ptr=U+converted*uv_pixel_stride/uv_x_sample_interval,
+				*v_ptr=V+converted*uv_pixel_stride/uv_x_sample_interval;
+
+			uint8_t *rgb_ptr=RGB+converted*rgb_pixel_stride;
+
+			STD_FUNCTION_NAME(width-converted, height, y_ptr, u_ptr, v_ptr, Y_stride, UV_stride, rgb_ptr, RGB_stride, yuv_type);
+		}
+	}
+}
+
+#undef AVX512_FUNCTION_NAME
+#undef STD_FUNCTION_NAME
+#undef YUV_FORMAT
+#undef RGB_FORMAT
+#undef READ_Y
+#undef READ_UV
+#undef ADD_Y2RGB_32
+#undef RGB565_32
+#undef PACK_32BPP
+#undef SAVE_LINE
+#undef YUV2RGB_32
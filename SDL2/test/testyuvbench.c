@@ -0,0 +1,151 @@
+/*
+  Copyright (C) 1997-2023 Sam Lantinga <slouken@libsdl.org>
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely.
+*/
+
+/* Micro-benchmark of the YUV to RGB kernels behind SDL_ConvertPixels().
+ * SDL_YUV_SIMD caps the kernel tier, each tier the CPU has is timed per format.
+ * The avx2 and avx512 output is checked against sse, which they replace; sse
+ * itself is not checked against std, it wraps on out of gamut samples.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "SDL.h"
+
+static const struct
+{
+    const char *name;
+    SDL_bool (*supported)(void);
+} levels[] = {
+    { "std", NULL },
+    { "sse", SDL_HasSSE2 },
+    { "avx2", SDL_HasAVX2 },
+    { "avx512", SDL_HasAVX512F },
+};
+
+static const Uint32 yuv_formats[] = {
+    SDL_PIXELFORMAT_IYUV,
+    SDL_PIXELFORMAT_NV12,
+    SDL_PIXELFORMAT_YUY2,
+};
+
+static const Uint32 rgb_formats[] = {
+    SDL_PIXELFORMAT_RGB565,
+    SDL_PIXELFORMAT_RGB24,
+    SDL_PIXELFORMAT_ARGB8888,
+    SDL_PIXELFORMAT_ABGR8888,
+    SDL_PIXELFORMAT_RGBA8888,
+    SDL_PIXELFORMAT_BGRA8888,
+};
+
+/* Studio range samples */
+static void fill_yuv(Uint8 *yuv, int size)
+{
+    int i;
+
+    for (i = 0; i < size; ++i) {
+        yuv[i] = (Uint8)(16 + (rand() % 220));
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int width = 1920;
+    int height = 1080;
+    int iterations = 50;
+    int yuv_pitch, rgb_pitch;
+    Uint8 *yuv, *rgb, *reference;
+    int result = 0;
+    int i, f, r, l;
+
+    for (i = 1; i < argc; ++i) {
+        if (SDL_strcmp(argv[i], "--width") == 0 && i + 1 < argc) {
+            width = SDL_atoi(argv[++i]);
+        } else if (SDL_strcmp(argv[i], "--height") == 0 && i + 1 < argc) {
+            height = SDL_atoi(argv[++i]);
+        } else if (SDL_strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            iterations = SDL_atoi(argv[++i]);
+        } else {
+            SDL_Log("Usage: %s [--width W] [--height H] [--iterations N]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (width < 2 || height < 2 || iterations < 1) {
+        SDL_Log("Invalid size or iteration count\n");
+        return 1;
+    }
+
+    /* 422 packed is the largest YUV layout, 4 bytes per pixel the largest RGB one */
+    yuv_pitch = ((width + 1) / 2) * 4;
+    rgb_pitch = width * 4;
+    yuv = (Uint8 *)SDL_malloc((size_t)yuv_pitch * height);
+    rgb = (Uint8 *)SDL_malloc((size_t)rgb_pitch * height);
+    reference = (Uint8 *)SDL_malloc((size_t)rgb_pitch * height);
+    if (yuv == NULL || rgb == NULL || reference == NULL) {
+        SDL_Log("Out of memory\n");
+        return 1;
+    }
+    fill_yuv(yuv, yuv_pitch * height);
+
+    SDL_Log("%dx%d, %d iterations, Mpix/s\n", width, height, iterations);
+    for (f = 0; f < SDL_arraysize(yuv_formats); ++f) {
+        Uint32 yuv_format = yuv_formats[f];
+        int pitch = (yuv_format == SDL_PIXELFORMAT_YUY2) ? yuv_pitch : width;
+
+        for (r = 0; r < SDL_arraysize(rgb_formats); ++r) {
+            Uint32 rgb_format = rgb_formats[r];
+            char line[256];
+
+            SDL_snprintf(line, sizeof(line), "%-6s -> %-16s", SDL_GetPixelFormatName(yuv_format) + 16, SDL_GetPixelFormatName(rgb_format) + 16);
+            for (l = 0; l < SDL_arraysize(levels); ++l) {
+                Uint64 start, elapsed;
+                double mpix;
+                int n;
+
+                if (levels[l].supported && !levels[l].supported()) {
+                    continue;
+                }
+                SDL_SetHint("SDL_YUV_SIMD", levels[l].name);
+
+                /* warm up, and the output checked against sse */
+                if (SDL_ConvertPixels(width, height, yuv_format, yuv, pitch, rgb_format, rgb, rgb_pitch) < 0) {
+                    SDL_Log("SDL_ConvertPixels failed: %s\n", SDL_GetError());
+                    return 1;
+                }
+                if (l == 1) {
+                    SDL_memcpy(reference, rgb, (size_t)rgb_pitch * height);
+                } else if (l > 1 && SDL_memcmp(reference, rgb, (size_t)rgb_pitch * height) != 0) {
+                    SDL_Log("%s: %s output differs from sse\n", line, levels[l].name);
+                    result = 1;
+                }
+
+                start = SDL_GetPerformanceCounter();
+                for (n = 0; n < iterations; ++n) {
+                    SDL_ConvertPixels(width, height, yuv_format, yuv, pitch, rgb_format, rgb, rgb_pitch);
+                }
+                elapsed = SDL_GetPerformanceCounter() - start;
+
+                mpix = ((double)width * height * iterations) / ((double)elapsed / SDL_GetPerformanceFrequency()) / 1000000.0;
+                SDL_snprintf(line + SDL_strlen(line), sizeof(line) - SDL_strlen(line), "  %s %8.1f", levels[l].name, mpix);
+            }
+            SDL_Log("%s\n", line);
+        }
+    }
+
+    SDL_free(yuv);
+    SDL_free(rgb);
+    SDL_free(reference);
+    return result;
+}
+
+/* vi: set ts=4 sw=4 expandtab: */
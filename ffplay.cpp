@@ -34,6 +34,30 @@
 #include <signal.h>
 #include <stdint.h>
 
+// config.h is generated on linux, its HAVE_ flags don't hold for the windows build
+#ifdef _WIN32
+  #include <windows.h>
+  #include <psapi.h>
+#elif HAVE_SYS_RESOURCE_H
+  #include <sys/time.h>
+  #include <sys/resource.h>
+#endif
+
+#if HAVE_UNISTD_H && !defined(_WIN32)
+  #include <sys/stat.h>
+  #include <fcntl.h>
+  #include <unistd.h>
+#endif
+#if HAVE_MMAP && !defined(_WIN32)
+  #include <sys/mman.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64)
+  #include <immintrin.h>
+#elif defined(__ARM_NEON)
+  #include <arm_neon.h>
+#endif
+
 extern "C" {
 #include "libavutil/avstring.h"
 #include "libavutil/channel_layout.h"
@@ -75,6 +99,17 @@ const int program_birth_year = 2003;
 
 #define MAX_QUEUE_SIZE (15 * 1024 * 1024)
 #define MIN_FRAMES 25
+
+/* read-ahead pauses once every stream is past its high watermark, resumes when one drains below its low one.
+   The decoders signal the drain, the wait timeout only covers a signal the read thread missed */
+#define READ_AHEAD_LOW 0.5
+#define READ_AHEAD_HIGH 1.0
+#define READ_AHEAD_WAIT 100
+
+/* packet ring and recycled packet pool, preallocated so steady state playback allocates nothing.
+   The ring grows without limit as the unbounded list did, the pool keeps at most PACKET_POOL_MAX_SIZE shells */
+#define PACKET_QUEUE_INIT_SIZE 256
+#define PACKET_POOL_MAX_SIZE 16384
 #define EXTERNAL_CLOCK_MIN_FRAMES 2
 #define EXTERNAL_CLOCK_MAX_FRAMES 10
 
@@ -84,6 +119,14 @@ const int program_birth_year = 2003;
 /* Calculate actual buffer size keeping in mind not cause too frequent audio callbacks */
 #define SDL_AUDIO_MAX_CALLBACKS_PER_SEC 30
 
+/* -lowlatency callbacks of about 5ms, doubled towards the default on underrun */
+#define SDL_AUDIO_LOWLATENCY_CALLBACKS_PER_SEC 200
+#define SDL_AUDIO_LOWLATENCY_MIN_SAMPLES 64
+
+/* underruns within this window, in us, that grow the -lowlatency buffer */
+#define AUDIO_UNDERRUN_WINDOW 1000000
+#define AUDIO_UNDERRUN_GROW 2
+
 /* Step size for volume control in dB */
 #define SDL_VOLUME_STEP (0.75)
 
@@ -107,12 +150,27 @@ const int program_birth_year = 2003;
 #define EXTERNAL_CLOCK_SPEED_MAX  1.010
 #define EXTERNAL_CLOCK_SPEED_STEP 0.001
 
+/* trick play steps the speed up to the max, audio is muted and the external clock leads above AUDIO_STRETCH_MAX.
+   From TRICK_NONREF_SPEED unreferenced frames are skipped, from -trick_keyframe_speed only keyframes are read and decoded */
+#define SPEED_MIN 0.25
+#define TRICK_SPEED_MAX 32.0
+#define TRICK_NONREF_SPEED 2.0
+
+/* up to AUDIO_STRETCH_MAX the audio keeps playing, atempo stretches it without changing its pitch.
+   A stretch costing more than AUDIO_STRETCH_MAX_LOAD of the audio it makes, over AUDIO_STRETCH_WINDOW of it, mutes that speed */
+#define AUDIO_STRETCH_MAX 4.0
+#define AUDIO_STRETCH_MAX_LOAD 0.5
+#define AUDIO_STRETCH_WINDOW 1.0
+
 /* we use about AUDIO_DIFF_AVG_NB A-V differences to make the average */
 #define AUDIO_DIFF_AVG_NB   20
 
 /* polls for possible required screen refresh at least this often, should be less than 1/fps */
 #define REFRESH_RATE 0.01
 
+/* wakes a paused eventLoop this often, only to keep the status line live */
+#define STATUS_REFRESH_RATE 1.0
+
 /* NOTE: the size must be big enough to compensate the hardware audio buffersize size */
 /* TODO: We assume that a decoded and resampled frame fits into this buffer */
 #define SAMPLE_ARRAY_SIZE (8 * 65536)
@@ -121,9 +179,55 @@ const int program_birth_year = 2003;
 
 #define VIDEO_PICTURE_QUEUE_SIZE 3
 #define SUBPICTURE_QUEUE_SIZE 16
-#define SAMPLE_QUEUE_SIZE 9
-#define FRAME_QUEUE_SIZE FFMAX(SAMPLE_QUEUE_SIZE, FFMAX(VIDEO_PICTURE_QUEUE_SIZE, SUBPICTURE_QUEUE_SIZE))
-
+#define FRAME_QUEUE_SIZE FFMAX(VIDEO_PICTURE_QUEUE_SIZE, SUBPICTURE_QUEUE_SIZE)
+
+/* output pcm converted ahead of the audio callback, in ms, and the most frames it can hold */
+#define AUDIO_RING_MS 200
+#define AUDIO_RING_CHUNKS 256
+
+#define CACHE_LINE_SIZE 64
+
+/* upload slices are split on even luma rows, keep each one worth a thread wakeup */
+#define MAX_UPLOAD_THREADS 16
+#define MIN_UPLOAD_SLICE_ROWS 64
+
+/* telemetry keeps the most recent records, older ones are overwritten */
+#define TELEMETRY_FRAME_RING_SIZE 16384
+#define TELEMETRY_AUDIO_RING_SIZE 16384
+
+/* trace spans are kept per thread, the most recent per thread when a buffer wraps */
+#define TRACE_MAX_THREADS 32
+#define TRACE_THREAD_SPANS 65536
+
+/* the AVIOContext buffer of the mmap and async inputs */
+#define AVIO_BUFFER_SIZE (256 * 1024)
+
+/* mmap input, pages ahead of the read position are prefetched and pages well behind it dropped,
+   re-advised each time the read position moves on a step. A seek prefetches its target */
+#define MMAP_READ_AHEAD (32 * 1024 * 1024)
+#define MMAP_KEEP_BEHIND (8 * 1024 * 1024)
+#define MMAP_ADVISE_STEP (4 * 1024 * 1024)
+#define MMAP_SEEK_PREFETCH (4 * 1024 * 1024)
+
+/* async input, a ring of large blocks read ahead of the demuxer, a local file with several reads in flight */
+#define ASYNC_IO_BLOCK_SIZE (1024 * 1024)
+#define ASYNC_IO_BLOCKS 16
+#define ASYNC_IO_MAX_THREADS 16
+
+/* keyframe index sidecar, a header then pts and pos of each keyframe, all little endian */
+#define KIDX_TAG MKTAG('K','I','D','X')
+#define KIDX_VERSION 1
+#define KIDX_HEADER_SIZE 36
+#define KIDX_ENTRY_SIZE 16
+
+/* scrub thumbnails, one per step of the timeline, the packet limit gives up on a target with no decodable keyframe near it */
+#define THUMBNAIL_WIDTH 240
+#define THUMBNAIL_STEP (2 * AV_TIME_BASE)
+#define THUMBNAIL_CACHE_SIZE 64
+#define THUMBNAIL_MAX_PACKETS 500
+#define THUMBNAIL_MARGIN 16
+
+#define FF_REFRESH_EVENT (SDL_USEREVENT + 1)
 #define FF_QUIT_EVENT (SDL_USEREVENT + 2)
 //}}}
 
@@ -155,6 +259,11 @@ const struct sTextureFormatEntry {
   { AV_PIX_FMT_YUV420P,        SDL_PIXELFORMAT_IYUV },
   { AV_PIX_FMT_YUYV422,        SDL_PIXELFORMAT_YUY2 },
   { AV_PIX_FMT_UYVY422,        SDL_PIXELFORMAT_UYVY },
+  { AV_PIX_FMT_NV12,           SDL_PIXELFORMAT_NV12 },
+  { AV_PIX_FMT_NV21,           SDL_PIXELFORMAT_NV21 },
+  // high bit depth, downconverted into the locked 8 bit texture by uploadTexture
+  { AV_PIX_FMT_P010,           SDL_PIXELFORMAT_NV12 },
+  { AV_PIX_FMT_YUV420P10,      SDL_PIXELFORMAT_IYUV },
   { AV_PIX_FMT_NONE,           SDL_PIXELFORMAT_UNKNOWN },
   };
 //}}}
@@ -168,8 +277,18 @@ namespace {
 
   static SDL_AudioDeviceID gAudioDevice;
   static int64_t gAudioCallbackTime = 0;
+  static int gAudioTraceBuffer = -1;  // claimed by audioOpen, the callback thread must not allocate its own
 
   static int gFullScreen = 0;
+
+  static SDL_atomic_t gRefreshEventPending;
+  static int64_t gEventLoopWakeups = 0;
+  static int64_t gReadWakeups = 0;
+
+  // per stream read-ahead watermarks in seconds of packets, and byte budget, whose low mark is half of it
+  static double gReadAheadLow = READ_AHEAD_LOW;
+  static double gReadAheadHigh = READ_AHEAD_HIGH;
+  static int gReadAheadKB = MAX_QUEUE_SIZE / 1024;
   //}}}
   //{{{  option vars
   static const AVInputFormat* gInputFileFormat;
@@ -231,6 +350,24 @@ namespace {
   static int autorotate = 1;
   static int find_stream_info = 1;
   static int filter_nbthreads = 0;
+  static int gUploadThreads = 0;
+  static int gAudioFloat = 1;
+  static int gLowLatency = 0;
+
+  static const char* gTelemetryUrl = NULL;
+  static const char* gTelemetryFormat = NULL;
+
+  static int gBench = 0;
+  static const char* gTraceUrl = NULL;
+
+  static int gMmap = 0;
+  static int gAsyncIo = 0;
+  static int gKeyframeIndex = 1;
+  static int gAccurateSeek = 0;
+  static double gTrickKeyframeSpeed = 4.0;
+  static double gSpeed = 1.0;
+  // ] and [ step through these
+  static const double gSpeedSteps[] = { 0.25, 0.5, 0.75, 1.0, 1.25, 1.5, 2.0, 3.0, 4.0, 8.0, 16.0, 32.0 };
   //}}}
   //{{{  filter
   //{{{
@@ -281,179 +418,1850 @@ namespace {
     }
   //}}}
   //}}}
-  //{{{  video
+  //{{{  telemetry
   //{{{
-  int computeMod (int a, int b) {
-    return a < 0 ? a%b + b : a%b;
-    }
+  enum eTelemetryEvent { TELEMETRY_SHOWN, TELEMETRY_DROP_EARLY, TELEMETRY_DROP_LATE };
   //}}}
-
   //{{{
-  void calculateDisplayRect (SDL_Rect* rect,
-                             int scr_xleft, int scr_ytop, int scr_width, int scr_height,
-                             int pic_width, int pic_height, AVRational pic_sar) {
+  struct sTelemetryFrame {
+    int64_t time;        // us since telemetry start, when the frame was shown or dropped
+    int event;           // eTelemetryEvent
+    double pts;
+    double duration;     // nominal duration of the previous frame
+    double targetDelay;  // compute_target_delay result, 0 for early drops
+    int64_t deadline;    // us, frame_timer the frame was due at
+    int64_t present;     // us, after SDL_RenderPresent, 0 if never presented
+    double avDiff;       // master clock - video clock
+
+    int aqSize;
+    int vqSize;
+    int sqSize;
+    int pictqFrames;
+    };
+  //}}}
+  //{{{
+  struct sTelemetryAudio {
+    int64_t time;        // us since telemetry start, on sdlAudioCallback entry
+    int64_t interval;    // us since the previous callback
+    int64_t expected;    // us, the previous callback's len at the output rate
+    int writeBufSize;    // bytes left unplayed in the ring chunk being played
+    int aqSize;
+    };
+  //}}}
+  //{{{
+  class cTelemetry {
+  // per frame and per audio callback rings, exported as csv or json to an avio url at exit
+  // - slots are claimed with an atomic add, the video thread, render thread and audio callback all write
+  // - only read by exit, after every writer has stopped
+  public:
+    //{{{
+    int init (const char* newUrl, const char* newFormat) {
 
-    AVRational aspect_ratio = pic_sar;
+      if (newFormat && strcmp (newFormat, "csv") && strcmp (newFormat, "json")) {
+        av_log (NULL, AV_LOG_FATAL, "Unknown telemetry format %s, expected csv or json\n", newFormat);
+        return AVERROR(EINVAL);
+        }
 
-    if (av_cmp_q (aspect_ratio, av_make_q (0, 1)) <= 0)
-      aspect_ratio = av_make_q (1, 1);
+      frames = (sTelemetryFrame*)av_calloc (TELEMETRY_FRAME_RING_SIZE, sizeof(sTelemetryFrame));
+      audio = (sTelemetryAudio*)av_calloc (TELEMETRY_AUDIO_RING_SIZE, sizeof(sTelemetryAudio));
+      if (!frames || !audio) {
+        av_freep (&frames);
+        av_freep (&audio);
+        return AVERROR(ENOMEM);
+        }
 
-    aspect_ratio = av_mul_q (aspect_ratio, av_make_q(pic_width, pic_height));
+      url = newUrl;
+      json = newFormat ? !strcmp (newFormat, "json") : av_match_ext (newUrl, "json");
+      startTime = av_gettime_relative();
+      SDL_AtomicSet (&numFrames, 0);
+      SDL_AtomicSet (&numAudio, 0);
+      return 0;
+      }
+    //}}}
+    //{{{
+    void exit() {
 
-    /* XXX: we suppose the screen has a 1.0 pixel ratio */
-    int height = scr_height;
-    int width = av_rescale (height, aspect_ratio.num, aspect_ratio.den) & ~1;
-    if (width > scr_width) {
-      width = scr_width;
-      height = av_rescale (width, aspect_ratio.den, aspect_ratio.num) & ~1;
+      if (frames)
+        write();
+      av_freep (&frames);
+      av_freep (&audio);
       }
+    //}}}
 
-    int x = (scr_width - width) / 2;
-    int y = (scr_height - height) / 2;
-    rect->x = scr_xleft + x;
-    rect->y = scr_ytop  + y;
-    rect->w = FFMAX((int)width,  1);
-    rect->h = FFMAX((int)height, 1);
-    }
-  //}}}
-  //{{{
-  void set_default_window_size (int width, int height, AVRational sar) {
+    bool isEnabled() { return frames != NULL; }
+    int64_t getTime (int64_t time) { return time - startTime; }
 
-    SDL_Rect rect;
-    int max_width  = screen_width  ? screen_width  : INT_MAX;
-    int max_height = screen_height ? screen_height : INT_MAX;
-    if (max_width == INT_MAX && max_height == INT_MAX)
-      max_height = height;
+    //{{{
+    sTelemetryFrame* addFrame (eTelemetryEvent event) {
+    // claim the next frame slot, NULL when disabled
 
-    calculateDisplayRect (&rect, 0, 0, max_width, max_height, width, height, sar);
+      if (!frames)
+        return NULL;
 
-    default_width = rect.w;
-    default_height = rect.h;
-    }
-  //}}}
+      sTelemetryFrame* record = &frames[(unsigned)SDL_AtomicAdd (&numFrames, 1) % TELEMETRY_FRAME_RING_SIZE];
+      memset (record, 0, sizeof(*record));
+      record->time = av_gettime_relative() - startTime;
+      record->event = event;
+      return record;
+      }
+    //}}}
+    //{{{
+    void addAudioCallback (int64_t callbackTime, int64_t expected, int writeBufSize, int aqSize) {
 
-  //{{{
-  void drawRectangle (int x, int y, int width, int height) {
+      if (!audio)
+        return;
 
-    SDL_Rect rect;
-    rect.x = x;
-    rect.y = y;
-    rect.w = width;
-    rect.h = height;
+      sTelemetryAudio* record = &audio[(unsigned)SDL_AtomicAdd (&numAudio, 1) % TELEMETRY_AUDIO_RING_SIZE];
+      record->time = callbackTime - startTime;
+      record->interval = lastAudioCallback ? callbackTime - lastAudioCallback : 0;
+      record->expected = expected;
+      record->writeBufSize = writeBufSize;
+      record->aqSize = aqSize;
+      lastAudioCallback = callbackTime;
+      }
+    //}}}
 
-    if (width && height)
-      SDL_RenderFillRect (gRenderer, &rect);
-    }
-  //}}}
+  private:
+    //{{{
+    void write() {
 
-  //{{{
-  void setSdlYuvConversionMode (AVFrame* frame) {
+      AVIOContext* pb = NULL;
+      int ret = avio_open2 (&pb, url, AVIO_FLAG_WRITE, NULL, NULL);
+      if (ret < 0) {
+        //{{{  error return
+        print_error (url, ret);
+        return;
+        }
+        //}}}
 
-    SDL_YUV_CONVERSION_MODE mode = SDL_YUV_CONVERSION_AUTOMATIC;
+      static const char* eventNames[] = { "shown", "drop_early", "drop_late" };
 
-    if (frame && (frame->format == AV_PIX_FMT_YUV420P
-                  || frame->format == AV_PIX_FMT_YUYV422
-                  || frame->format == AV_PIX_FMT_UYVY422)) {
-      if (frame->color_range == AVCOL_RANGE_JPEG)
-         mode = SDL_YUV_CONVERSION_JPEG;
-      else if (frame->colorspace == AVCOL_SPC_BT709)
-        mode = SDL_YUV_CONVERSION_BT709;
-      else if (frame->colorspace == AVCOL_SPC_BT470BG || frame->colorspace == AVCOL_SPC_SMPTE170M)
-        mode = SDL_YUV_CONVERSION_BT601;
+      int totalFrames = SDL_AtomicGet (&numFrames);
+      int totalAudio = SDL_AtomicGet (&numAudio);
+      int firstFrame = FFMAX(totalFrames - TELEMETRY_FRAME_RING_SIZE, 0);
+      int firstAudio = FFMAX(totalAudio - TELEMETRY_AUDIO_RING_SIZE, 0);
+
+      if (json)
+        avio_printf (pb, "{\n  \"frames\": [\n");
+      else
+        avio_printf (pb, "frame,time_us,event,pts,duration,target_delay,deadline_us,present_us,av_diff,aq,vq,sq,pictq\n");
+
+      for (int i = firstFrame; i < totalFrames; i++) {
+        sTelemetryFrame* f = &frames[i % TELEMETRY_FRAME_RING_SIZE];
+        if (json)
+          avio_printf (pb, "    { \"frame\": %d, \"time_us\": %" PRId64 ", \"event\": \"%s\", \"pts\": %.6f, "
+                           "\"duration\": %.6f, \"target_delay\": %.6f, \"deadline_us\": %" PRId64 ", "
+                           "\"present_us\": %" PRId64 ", \"av_diff\": %.6f, \"aq\": %d, \"vq\": %d, \"sq\": %d, \"pictq\": %d }%s\n",
+                       i, f->time, eventNames[f->event], isnan (f->pts) ? -1.0 : f->pts,
+                       f->duration, f->targetDelay, f->deadline,
+                       f->present, isnan (f->avDiff) ? 0.0 : f->avDiff, f->aqSize, f->vqSize, f->sqSize, f->pictqFrames,
+                       i + 1 < totalFrames ? "," : "");
+        else
+          avio_printf (pb, "%d,%" PRId64 ",%s,%.6f,%.6f,%.6f,%" PRId64 ",%" PRId64 ",%.6f,%d,%d,%d,%d\n",
+                       i, f->time, eventNames[f->event], f->pts,
+                       f->duration, f->targetDelay, f->deadline,
+                       f->present, f->avDiff, f->aqSize, f->vqSize, f->sqSize, f->pictqFrames);
+        }
+
+      if (json)
+        avio_printf (pb, "  ],\n  \"audio\": [\n");
+      else
+        avio_printf (pb, "\ncallback,time_us,interval_us,expected_us,jitter_us,write_buf,aq\n");
+
+      for (int i = firstAudio; i < totalAudio; i++) {
+        sTelemetryAudio* a = &audio[i % TELEMETRY_AUDIO_RING_SIZE];
+        int64_t jitter = a->interval ? a->interval - a->expected : 0;
+        if (json)
+          avio_printf (pb, "    { \"callback\": %d, \"time_us\": %" PRId64 ", \"interval_us\": %" PRId64 ", "
+                           "\"expected_us\": %" PRId64 ", \"jitter_us\": %" PRId64 ", \"write_buf\": %d, \"aq\": %d }%s\n",
+                       i, a->time, a->interval, a->expected, jitter, a->writeBufSize, a->aqSize,
+                       i + 1 < totalAudio ? "," : "");
+        else
+          avio_printf (pb, "%d,%" PRId64 ",%" PRId64 ",%" PRId64 ",%" PRId64 ",%d,%d\n",
+                       i, a->time, a->interval, a->expected, jitter, a->writeBufSize, a->aqSize);
+        }
+
+      if (json)
+        avio_printf (pb, "  ]\n}\n");
+
+      avio_closep (&pb);
+      av_log (NULL, AV_LOG_INFO, "Wrote %d frame and %d audio telemetry records to %s\n",
+              totalFrames - firstFrame, totalAudio - firstAudio, url);
       }
+    //}}}
 
-    SDL_SetYUVConversionMode (mode); /* FIXME: no support for linear transfer */
+    const char* url;
+    int json;
+    int64_t startTime;
+
+    sTelemetryFrame* frames;
+    SDL_atomic_t numFrames;
+
+    sTelemetryAudio* audio;
+    SDL_atomic_t numAudio;
+    int64_t lastAudioCallback;  // audio callback thread only
+    };
+  //}}}
+  static cTelemetry gTelemetry;
+  //}}}
+  //{{{  bench
+  //{{{
+  enum eBenchStage { BENCH_DEMUX, BENCH_DECODE, BENCH_FILTER, BENCH_UPLOAD, BENCH_RENDER, BENCH_NB };
+  //}}}
+  //{{{
+  int64_t getBenchTime() {
+  // ns, from the performance counter, av_gettime_relative is only us
+
+    return av_rescale (SDL_GetPerformanceCounter(), 1000000000, SDL_GetPerformanceFrequency());
     }
   //}}}
   //{{{
-  void getSdlPixfmtAndBlendmode (int format, Uint32* sdl_pix_fmt, SDL_BlendMode* sdl_blendmode) {
+  int64_t getMaxRss() {
+  // peak resident set in bytes, as ffmpeg -benchmark reports it
+
+    #ifdef _WIN32
+      PROCESS_MEMORY_COUNTERS memcounters;
+      memcounters.cb = sizeof(memcounters);
+      GetProcessMemoryInfo (GetCurrentProcess(), &memcounters, sizeof(memcounters));
+      return memcounters.PeakWorkingSetSize;
+    #elif HAVE_GETRUSAGE && HAVE_STRUCT_RUSAGE_RU_MAXRSS
+      struct rusage rusage;
+      getrusage (RUSAGE_SELF, &rusage);
+      return (int64_t)rusage.ru_maxrss * 1024;
+    #else
+      return 0;
+    #endif
+    }
+  //}}}
+  //{{{
+  int compareInt64 (const void* a, const void* b) {
+    return FFDIFFSIGN(*(const int64_t*)a, *(const int64_t*)b);
+    }
+  //}}}
+  //{{{
+  class cBenchStage {
+  // ns per item of one pipeline stage, each stage is only timed from the one thread that runs it
+  public:
+    //{{{
+    void add (int64_t startTime) {
 
-    *sdl_blendmode = SDL_BLENDMODE_NONE;
-    if (format == AV_PIX_FMT_RGB32   ||
-        format == AV_PIX_FMT_RGB32_1 ||
-        format == AV_PIX_FMT_BGR32   ||
-        format == AV_PIX_FMT_BGR32_1)
-      *sdl_blendmode = SDL_BLENDMODE_BLEND;
+      if (count == size) {
+        int newSize = size ? size * 2 : 4096;
+        int64_t* newSamples = (int64_t*)av_realloc_array (samples, newSize, sizeof(int64_t));
+        if (!newSamples)
+          return;
+        samples = newSamples;
+        size = newSize;
+        }
 
-    *sdl_pix_fmt = SDL_PIXELFORMAT_UNKNOWN;
-    for (int i = 0; i < FF_ARRAY_ELEMS (sdlTextureFormatMap) - 1; i++) {
-      if (format == sdlTextureFormatMap[i].format) {
-        *sdl_pix_fmt = sdlTextureFormatMap[i].texture_fmt;
+      int64_t ns = getBenchTime() - startTime;
+      samples[count++] = ns;
+      total += ns;
+      }
+    //}}}
+    //{{{
+    void report (const char* name, const char* unit) {
+
+      if (!count) {
+        av_log (NULL, AV_LOG_INFO, "bench: %-6s %8d %-7s\n", name, 0, unit);
         return;
         }
+
+      qsort (samples, count, sizeof(int64_t), compareInt64);
+      av_log (NULL, AV_LOG_INFO, "bench: %-6s %8d %-7s %9.1f/s  p50 %9" PRId64 "  p90 %9" PRId64 "  p99 %9" PRId64 "  max %9" PRId64 " ns\n",
+              name, count, unit, count * 1000000000.0 / FFMAX(total, 1),
+              samples[count / 2], samples[count * 9 / 10], samples[count * 99 / 100], samples[count - 1]);
       }
-    }
+    //}}}
+    //{{{
+    void exit() {
+
+      av_freep (&samples);
+      count = size = 0;
+      total = 0;
+      }
+    //}}}
+
+  private:
+    int64_t* samples;
+    int count;
+    int size;
+    int64_t total;
+    };
   //}}}
+  static cBenchStage gBenchStages[BENCH_NB];
+  static int64_t gBenchStartTime;
+  //{{{
+  void benchReport() {
+  // rates are items per second of time spent in the stage, what it could sustain on its own
+
+    static const char* names[BENCH_NB] = { "demux", "decode", "filter", "upload", "render" };
+    static const char* units[BENCH_NB] = { "packets", "frames", "frames", "frames", "frames" };
 
+    double wallTime = (getBenchTime() - gBenchStartTime) / 1000000000.0;
+    av_log (NULL, AV_LOG_INFO, "bench: %.3fs wall, peak rss %" PRId64 " KB\n", wallTime, getMaxRss() / 1024);
+    for (int i = 0; i < BENCH_NB; i++) {
+      gBenchStages[i].report (names[i], units[i]);
+      gBenchStages[i].exit();
+      }
+    }
+  //}}}
+  //}}}
+  //{{{  trace
   //{{{
-  int reallocTexture (SDL_Texture** texture, Uint32 new_format,
-                              int new_width, int new_height, SDL_BlendMode blendmode, int initTexture) {
+  struct sTraceSpan {
+    const char* cat;
+    const char* name;
+    int64_t start;  // ns, getBenchTime
+    int64_t end;
+    };
+  //}}}
+  //{{{
+  class cTrace {
+  // spans into per thread buffers, written as a chrome/perfetto json trace at exit
+  // - a thread claims its buffer once with an atomic add, after that only it writes there
+  // - the audio callback adopts one audioOpen reserved, its first span would otherwise allocate and log
+  // - only read by exit, after every traced thread has stopped
+  public:
+    //{{{
+    int init (const char* newUrl) {
 
-    Uint32 format;
-    int access, w, h;
-    if (!*texture
-        || SDL_QueryTexture (*texture, &format, &access, &w, &h) < 0
-        || new_width != w || new_height != h
-        || new_format != format) {
+      url = newUrl;
+      startTime = getBenchTime();
+      SDL_AtomicSet (&numBuffers, 0);
+      enabled = true;
+      return 0;
+      }
+    //}}}
+    //{{{
+    void exit() {
 
-      if (*texture)
-        SDL_DestroyTexture (*texture);
+      if (!enabled)
+        return;
+      enabled = false;
 
-      if (!(*texture = SDL_CreateTexture (gRenderer, new_format, SDL_TEXTUREACCESS_STREAMING, new_width, new_height)))
+      write();
+      int num = FFMIN(SDL_AtomicGet (&numBuffers), TRACE_MAX_THREADS);
+      for (int i = 0; i < num; i++)
+        av_freep (&buffers[i].spans);
+      }
+    //}}}
+
+    bool isEnabled() { return enabled; }
+
+    //{{{
+    void setThreadName (const char* name) {
+
+      sThreadBuffer* buffer = getThreadBuffer();
+      if (buffer && !buffer->name)
+        buffer->name = name;
+      }
+    //}}}
+    //{{{
+    int reserveThreadBuffer (const char* name) {
+    // claim and allocate a buffer ahead for a thread that must not allocate, -1 when there is none
+
+      if (!enabled)
         return -1;
 
-      if (SDL_SetTextureBlendMode (*texture, blendmode) < 0)
+      int index = SDL_AtomicAdd (&numBuffers, 1);
+      sTraceSpan* spans = index < TRACE_MAX_THREADS ? (sTraceSpan*)av_malloc_array (TRACE_THREAD_SPANS, sizeof(sTraceSpan)) : NULL;
+      if (!spans) {
+        av_log (NULL, AV_LOG_WARNING, "No trace buffer for %s, its spans are dropped\n", name);
         return -1;
+        }
 
-      if (initTexture) {
-        void* pixels;
-        int pitch;
-        if (SDL_LockTexture (*texture, NULL, &pixels, &pitch) < 0)
-          return -1;
+      buffers[index].name = name;
+      buffers[index].spans = spans;
+      return index;
+      }
+    //}}}
+    //{{{
+    void useThreadBuffer (int index) {
+    // adopt a reserved buffer, no allocation or logging, a thread reopened later takes it over
 
-        memset (pixels, 0, pitch * new_height);
-        SDL_UnlockTexture (*texture);
+      if (index < 0) {
+        threadBufferFailed = true;
+        return;
         }
 
-      av_log (NULL, AV_LOG_VERBOSE, "Created %dx%d texture with %s.\n", new_width, new_height, SDL_GetPixelFormatName(new_format));
+      if (threadBuffer != &buffers[index]) {
+        threadBuffer = &buffers[index];
+        threadBuffer->tid = SDL_ThreadID();
+        }
       }
+    //}}}
+    //{{{
+    void addSpan (const char* cat, const char* name, int64_t start, int64_t end) {
 
-    return 0;
-    }
-  //}}}
-  //{{{
-  int uploadTexture (SDL_Texture** tex, AVFrame* frame) {
+      sThreadBuffer* buffer = getThreadBuffer();
+      if (!buffer)
+        return;
 
-    Uint32 sdlPixelFormat;
-    SDL_BlendMode sdl_blendmode;
-    getSdlPixfmtAndBlendmode (frame->format, &sdlPixelFormat, &sdl_blendmode);
+      sTraceSpan* span = &buffer->spans[buffer->count++ % TRACE_THREAD_SPANS];
+      span->cat = cat;
+      span->name = name;
+      span->start = start;
+      span->end = end;
+      }
+    //}}}
 
-    if (reallocTexture (tex,
-      sdlPixelFormat == SDL_PIXELFORMAT_UNKNOWN ? SDL_PIXELFORMAT_ARGB8888 : sdlPixelFormat,
-                        frame->width, frame->height, sdl_blendmode, 0) < 0)
-      return -1;
+  private:
+    //{{{
+    struct sThreadBuffer {
+      SDL_threadID tid;
+      const char* name;
+      sTraceSpan* spans;
+      int64_t count;
+      };
+    //}}}
+    //{{{
+    sThreadBuffer* getThreadBuffer() {
 
-    int ret = 0;
-    switch (sdlPixelFormat) {
-      case SDL_PIXELFORMAT_IYUV:
-        if ((frame->linesize[0] > 0) && (frame->linesize[1] > 0) && (frame->linesize[2] > 0))
-          ret = SDL_UpdateYUVTexture (*tex, NULL,
-                                      frame->data[0], frame->linesize[0],
-                                      frame->data[1], frame->linesize[1],
-                                      frame->data[2], frame->linesize[2]);
-        else if ((frame->linesize[0] < 0) && (frame->linesize[1] < 0) && (frame->linesize[2] < 0))
-          ret = SDL_UpdateYUVTexture (*tex, NULL,
-                                      frame->data[0] + frame->linesize[0] * (frame->height - 1), -frame->linesize[0],
-                                      frame->data[1] + frame->linesize[1] * (AV_CEIL_RSHIFT(frame->height, 1) - 1), -frame->linesize[1],
-                                      frame->data[2] + frame->linesize[2] * (AV_CEIL_RSHIFT(frame->height, 1) - 1), -frame->linesize[2]);
-        else {
-          av_log (NULL, AV_LOG_ERROR, "Mixed negative and positive linesizes are not supported.\n");
-          return -1;
+      if (threadBuffer || threadBufferFailed || !enabled)
+        return threadBuffer;
+
+      int index = SDL_AtomicAdd (&numBuffers, 1);
+      sTraceSpan* spans = index < TRACE_MAX_THREADS ? (sTraceSpan*)av_malloc_array (TRACE_THREAD_SPANS, sizeof(sTraceSpan)) : NULL;
+      if (!spans) {
+        av_log (NULL, AV_LOG_WARNING, "No trace buffer for thread %lu, its spans are dropped\n", SDL_ThreadID());
+        threadBufferFailed = true;
+        return NULL;
+        }
+
+      // a failed claim leaves its slot spans NULL, exit skips it
+      threadBuffer = &buffers[index];
+      threadBuffer->tid = SDL_ThreadID();
+      threadBuffer->spans = spans;
+      return threadBuffer;
+      }
+    //}}}
+    //{{{
+    void write() {
+
+      AVIOContext* pb = NULL;
+      int ret = avio_open2 (&pb, url, AVIO_FLAG_WRITE, NULL, NULL);
+      if (ret < 0) {
+        //{{{  error return
+        print_error (url, ret);
+        return;
+        }
+        //}}}
+
+      int64_t numSpans = 0;
+      const char* sep = "";
+      avio_printf (pb, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+      int num = FFMIN(SDL_AtomicGet (&numBuffers), TRACE_MAX_THREADS);
+      for (int i = 0; i < num; i++) {
+        sThreadBuffer* buffer = &buffers[i];
+        if (!buffer->spans)
+          continue;
+
+        avio_printf (pb, "%s{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%lu,\"args\":{\"name\":\"%s\"}}",
+                     sep, buffer->tid, buffer->name ? buffer->name : "thread");
+        sep = ",\n";
+
+        for (int64_t j = FFMAX(buffer->count - TRACE_THREAD_SPANS, 0); j < buffer->count; j++) {
+          sTraceSpan* span = &buffer->spans[j % TRACE_THREAD_SPANS];
+          avio_printf (pb, "%s{\"ph\":\"X\",\"cat\":\"%s\",\"name\":\"%s\",\"pid\":1,\"tid\":%lu,\"ts\":%.3f,\"dur\":%.3f}",
+                       sep, span->cat, span->name, buffer->tid,
+                       (span->start - startTime) / 1000.0, (span->end - span->start) / 1000.0);
+          numSpans++;
           }
-        break;
+        }
 
-      default:
-        if (frame->linesize[0] < 0)
+      avio_printf (pb, "\n]}\n");
+      avio_closep (&pb);
+      av_log (NULL, AV_LOG_INFO, "Wrote %" PRId64 " trace spans from %d threads to %s\n", numSpans, num, url);
+      }
+    //}}}
+
+    bool enabled;
+    const char* url;
+    int64_t startTime;
+
+    sThreadBuffer buffers[TRACE_MAX_THREADS];
+    SDL_atomic_t numBuffers;
+
+    inline static thread_local sThreadBuffer* threadBuffer = NULL;
+    inline static thread_local bool threadBufferFailed = false;
+    };
+  //}}}
+  static cTrace gTrace;
+  //{{{
+  class cTraceSpan {
+  // one span, from construction to end() or destruction, nothing when tracing is off
+  public:
+    cTraceSpan (const char* cat, const char* name) : cat(cat), name(name), start(gTrace.isEnabled() ? getBenchTime() : 0) {}
+    ~cTraceSpan() { end(); }
+
+    //{{{
+    void end() {
+
+      if (start)
+        gTrace.addSpan (cat, name, start, getBenchTime());
+      start = 0;
+      }
+    //}}}
+
+  private:
+    const char* cat;
+    const char* name;
+    int64_t start;
+    };
+  //}}}
+  //}}}
+  //{{{  input
+  //{{{
+  class cMmapInput {
+  // local file mapped read only, read by avformat through its own AVIOContext
+  // - reads are a memcpy out of the mapping, no read syscall or kernel buffer copy per block
+  // - madvise keeps the kernel reading ahead of the read position and drops what is well behind it
+  // - state is all zero until open, close is safe either way
+  // - opt in, -mmap, the mapping stops at the size at open and a truncated or failing file raises SIGBUS, not EIO
+  public:
+    //{{{
+    int open (const char* filename) {
+
+    #if HAVE_MMAP && !defined(_WIN32)
+      const char* path = filename;
+      const char* protocol = avio_find_protocol_name (filename);
+      if (!protocol || strcmp (protocol, "file") || !strcmp (filename, "-"))
+        return AVERROR (ENOSYS);
+      av_strstart (filename, "file:", &path);
+
+      int fd = ::open (path, O_RDONLY);
+      if (fd < 0)
+        return AVERROR (errno);
+
+      struct stat st;
+      if (fstat (fd, &st) < 0 || !S_ISREG (st.st_mode) || st.st_size <= 0 || (uint64_t)st.st_size > SIZE_MAX) {
+        //{{{  error return, not a mappable file
+        ::close (fd);
+        return AVERROR (ENOSYS);
+        }
+        //}}}
+
+      // the mapping holds its own reference to the file
+      void* newMap = mmap (NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      int err = errno;
+      ::close (fd);
+      if (newMap == MAP_FAILED)
+        return AVERROR (err);
+
+      map = (const uint8_t*)newMap;
+      size = st.st_size;
+      pageSize = sysconf (_SC_PAGESIZE);
+      madvise ((void*)map, (size_t)size, MADV_SEQUENTIAL);
+      advise (0);
+
+      uint8_t* buffer = (uint8_t*)av_malloc (AVIO_BUFFER_SIZE);
+      if (buffer)
+        ioContext = avio_alloc_context (buffer, AVIO_BUFFER_SIZE, 0, this, readPacket, NULL, seek);
+      if (!ioContext) {
+        //{{{  error return
+        av_free (buffer);
+        close();
+        return AVERROR (ENOMEM);
+        }
+        //}}}
+
+      return 0;
+    #else
+      (void)filename;
+      return AVERROR (ENOSYS);
+    #endif
+      }
+    //}}}
+    //{{{
+    void close() {
+
+      if (ioContext)
+        av_freep (&ioContext->buffer);
+      avio_context_free (&ioContext);
+
+    #if HAVE_MMAP && !defined(_WIN32)
+      if (map)
+        munmap ((void*)map, (size_t)size);
+    #endif
+      map = NULL;
+      }
+    //}}}
+
+    AVIOContext* getIoContext() { return ioContext; }
+
+  private:
+    //{{{
+    static int readPacket (void* opaque, uint8_t* buf, int bufSize) {
+
+      cMmapInput* input = (cMmapInput*)opaque;
+      if (input->pos >= input->size)
+        return AVERROR_EOF;
+
+      int len = (int)FFMIN((int64_t)bufSize, input->size - input->pos);
+      memcpy (buf, input->map + input->pos, len);
+      input->pos += len;
+
+      if (input->pos >= input->advisedPos + MMAP_ADVISE_STEP)
+        input->advise (input->pos);
+      return len;
+      }
+    //}}}
+    //{{{
+    static int64_t seek (void* opaque, int64_t offset, int whence) {
+
+      cMmapInput* input = (cMmapInput*)opaque;
+
+      int64_t newPos;
+      switch (whence & ~AVSEEK_FORCE) {
+        case AVSEEK_SIZE: return input->size;
+        case SEEK_SET: newPos = offset; break;
+        case SEEK_CUR: newPos = input->pos + offset; break;
+        case SEEK_END: newPos = input->size + offset; break;
+        default: return AVERROR (EINVAL);
+        }
+      if (newPos < 0)
+        return AVERROR (EINVAL);
+
+      // a seek away from the read position prefetches its target, reading on from there re-advises as usual
+      if (newPos != input->pos) {
+        input->prefetch (newPos, MMAP_SEEK_PREFETCH);
+        input->advisedPos = newPos;
+        input->droppedPos = FFMAX(newPos - MMAP_KEEP_BEHIND, 0);
+        }
+      input->pos = newPos;
+      return newPos;
+      }
+    //}}}
+
+    //{{{
+    void prefetch (int64_t from, int64_t len) {
+
+    #if HAVE_MMAP && !defined(_WIN32)
+      int64_t start = from & ~(pageSize - 1);
+      int64_t end = FFMIN(from + len, size);
+      if (end > start)
+        madvise ((void*)(map + start), (size_t)(end - start), MADV_WILLNEED);
+    #endif
+      }
+    //}}}
+    //{{{
+    void advise (int64_t readPos) {
+
+      prefetch (readPos, MMAP_READ_AHEAD);
+      advisedPos = readPos;
+
+    #if HAVE_MMAP && !defined(_WIN32)
+      // only whole pages behind are dropped, the page holding droppedPos may still be read
+      int64_t start = (droppedPos + pageSize - 1) & ~(pageSize - 1);
+      int64_t end = (readPos - MMAP_KEEP_BEHIND) & ~(pageSize - 1);
+      if (end > start) {
+        madvise ((void*)(map + start), (size_t)(end - start), MADV_DONTNEED);
+        droppedPos = end;
+        }
+    #endif
+      }
+    //}}}
+
+    const uint8_t* map;
+    int64_t size;
+    int64_t pageSize;
+    AVIOContext* ioContext;
+
+    int64_t pos;
+    int64_t advisedPos;
+    int64_t droppedPos;
+    };
+  //}}}
+  //{{{
+  class cAsyncInput {
+  // reads ahead of the demuxer on its own threads into a ring of large blocks, read by avformat through its own AVIOContext
+  // - block b lives in slot b % ASYNC_IO_BLOCKS, the window is the blocks from the read position on
+  // - a local file gets several pread workers, so that many reads are in flight, any other url one avio reader
+  // - a slot being read is never reclaimed, a block read for a window a seek has left stays valid in its slot
+  public:
+    //{{{
+    int open (const char* filename, const AVIOInterruptCB* newInterrupt, int threads) {
+
+      interrupt = *newInterrupt;
+
+    #if HAVE_UNISTD_H && !defined(_WIN32)
+      const char* path = filename;
+      const char* protocol = avio_find_protocol_name (filename);
+      if (protocol && !strcmp (protocol, "file") && strcmp (filename, "-")) {
+        av_strstart (filename, "file:", &path);
+        fd = ::open (path, O_RDONLY);
+        struct stat st;
+        if (fd >= 0 && fstat (fd, &st) == 0 && S_ISREG (st.st_mode)) {
+          local = true;
+          size = st.st_size;
+          }
+        else if (fd >= 0)
+          ::close (fd);
+        }
+    #endif
+
+      if (!local) {
+        int ret = avio_open2 (&source, filename, AVIO_FLAG_READ, &interrupt, NULL);
+        if (ret < 0)
+          return ret;
+        if (!(source->seekable & AVIO_SEEKABLE_NORMAL)) {
+          //{{{  error return, only a seekable url is read ahead
+          avio_closep (&source);
+          return AVERROR (ENOSYS);
+          }
+          //}}}
+        size = avio_size (source);
+        threads = 1;
+        }
+
+      mutex = SDL_CreateMutex();
+      cond = SDL_CreateCond();
+      blocks = (uint8_t*)av_malloc ((size_t)ASYNC_IO_BLOCKS * ASYNC_IO_BLOCK_SIZE);
+      uint8_t* buffer = (uint8_t*)av_malloc (AVIO_BUFFER_SIZE);
+      if (buffer)
+        ioContext = avio_alloc_context (buffer, AVIO_BUFFER_SIZE, 0, this, readPacket, NULL, seek);
+      if (!mutex || !cond || !blocks || !ioContext) {
+        //{{{  error return
+        if (!ioContext)
+          av_free (buffer);
+        close();
+        return AVERROR (ENOMEM);
+        }
+        //}}}
+
+      endBlock = size > 0 ? (size + ASYNC_IO_BLOCK_SIZE - 1) / ASYNC_IO_BLOCK_SIZE : INT64_MAX;
+      for (int i = 0; i < ASYNC_IO_BLOCKS; i++)
+        slots[i].block = -1;
+      for (int i = 0; i < FFMIN(threads, ASYNC_IO_MAX_THREADS); i++) {
+        if (!(workers[numWorkers] = SDL_CreateThread (workerThread, "io", this))) {
+          av_log (NULL, AV_LOG_WARNING, "SDL_CreateThread(): %s\n", SDL_GetError());
+          break;
+          }
+        numWorkers++;
+        }
+      if (!numWorkers) {
+        //{{{  error return
+        close();
+        return AVERROR (ENOMEM);
+        }
+        //}}}
+
+      av_log (NULL, AV_LOG_VERBOSE, "Reading %s ahead on %d io threads, %d blocks of %dKB\n",
+              filename, numWorkers, ASYNC_IO_BLOCKS, ASYNC_IO_BLOCK_SIZE / 1024);
+      return 0;
+      }
+    //}}}
+    //{{{
+    void close() {
+
+      if (numWorkers) {
+        SDL_LockMutex (mutex);
+        quit = true;
+        SDL_CondBroadcast (cond);
+        SDL_UnlockMutex (mutex);
+        for (int i = 0; i < numWorkers; i++)
+          SDL_WaitThread (workers[i], NULL);
+        av_log (NULL, AV_LOG_VERBOSE, "io: %" PRId64 " blocks read, demuxer waited on io %" PRId64 " times\n",
+                blocksRead, stalls);
+        }
+      numWorkers = 0;
+
+      if (ioContext)
+        av_freep (&ioContext->buffer);
+      avio_context_free (&ioContext);
+      avio_closep (&source);
+    #if HAVE_UNISTD_H && !defined(_WIN32)
+      if (local)
+        ::close (fd);
+    #endif
+      local = false;
+
+      av_freep (&blocks);
+      if (cond)
+        SDL_DestroyCond (cond);
+      if (mutex)
+        SDL_DestroyMutex (mutex);
+      cond = NULL;
+      mutex = NULL;
+      }
+    //}}}
+
+    AVIOContext* getIoContext() { return ioContext; }
+
+  private:
+    //{{{
+    struct sSlot {
+      int64_t block;  // -1 empty
+      int len;        // bytes read, < ASYNC_IO_BLOCK_SIZE at the end, an AVERROR on a failed read
+      bool reading;
+      };
+    //}}}
+
+    //{{{
+    static int readPacket (void* opaque, uint8_t* buf, int bufSize) {
+
+      cAsyncInput* input = (cAsyncInput*)opaque;
+      SDL_LockMutex (input->mutex);
+
+      int ret;
+      bool stalled = false;
+      while (true) {
+        int64_t block = input->pos / ASYNC_IO_BLOCK_SIZE;
+        sSlot* slot = &input->slots[block % ASYNC_IO_BLOCKS];
+        if (slot->block == block && !slot->reading) {
+          int offset = (int)(input->pos - block * ASYNC_IO_BLOCK_SIZE);
+          if (slot->len < 0)
+            ret = slot->len;
+          else if (offset >= slot->len)
+            ret = AVERROR_EOF;
+          else {
+            ret = FFMIN(bufSize, slot->len - offset);
+            memcpy (buf, input->blocks + (block % ASYNC_IO_BLOCKS) * ASYNC_IO_BLOCK_SIZE + offset, ret);
+            input->pos += ret;
+            if (input->pos / ASYNC_IO_BLOCK_SIZE != block) {
+              // the slot is free for the block at the far end of the window
+              input->readBlock = block + 1;
+              SDL_CondBroadcast (input->cond);
+              }
+            }
+          break;
+          }
+
+        if (block >= input->endBlock) {
+          ret = AVERROR_EOF;
+          break;
+          }
+        if (input->interrupt.callback && input->interrupt.callback (input->interrupt.opaque)) {
+          ret = AVERROR_EXIT;
+          break;
+          }
+
+        if (!stalled)
+          input->stalls++;
+        stalled = true;
+        SDL_CondWaitTimeout (input->cond, input->mutex, 10);
+        }
+
+      SDL_UnlockMutex (input->mutex);
+      return ret;
+      }
+    //}}}
+    //{{{
+    static int64_t seek (void* opaque, int64_t offset, int whence) {
+
+      cAsyncInput* input = (cAsyncInput*)opaque;
+
+      int64_t newPos;
+      switch (whence & ~AVSEEK_FORCE) {
+        case AVSEEK_SIZE: return input->size > 0 ? input->size : AVERROR (ENOSYS);
+        case SEEK_SET: newPos = offset; break;
+        case SEEK_CUR: newPos = input->pos + offset; break;
+        case SEEK_END: newPos = input->size > 0 ? input->size + offset : -1; break;
+        default: return AVERROR (EINVAL);
+        }
+      if (newPos < 0)
+        return AVERROR (EINVAL);
+
+      SDL_LockMutex (input->mutex);
+      int64_t block = newPos / ASYNC_IO_BLOCK_SIZE;
+      if (block < input->readBlock || block >= input->fetchBlock) {
+        // outside what is read or being read, restart the window at the target
+        input->fetchBlock = block;
+        SDL_CondBroadcast (input->cond);
+        }
+      input->readBlock = block;
+      input->pos = newPos;
+      SDL_UnlockMutex (input->mutex);
+
+      return newPos;
+      }
+    //}}}
+
+    //{{{
+    static int workerThread (void* arg) {
+
+      gTrace.setThreadName ("io");
+      cAsyncInput* input = (cAsyncInput*)arg;
+
+      SDL_LockMutex (input->mutex);
+      while (!input->quit) {
+        // claim the next block of the window, skipping one still in its slot from earlier
+        int64_t block = input->fetchBlock;
+        sSlot* slot = &input->slots[block % ASYNC_IO_BLOCKS];
+        if ((block >= input->readBlock + ASYNC_IO_BLOCKS) || (block >= input->endBlock) || slot->reading) {
+          SDL_CondWait (input->cond, input->mutex);
+          continue;
+          }
+        input->fetchBlock++;
+        if (slot->block == block)
+          continue;
+        slot->block = block;
+        slot->reading = true;
+        SDL_UnlockMutex (input->mutex);
+
+        int len;
+        {
+        cTraceSpan span ("io", "read");
+        len = input->readAt (block, input->blocks + (block % ASYNC_IO_BLOCKS) * ASYNC_IO_BLOCK_SIZE);
+        }
+
+        SDL_LockMutex (input->mutex);
+        slot->len = len;
+        slot->reading = false;
+        input->blocksRead++;
+        if ((len >= 0) && (len < ASYNC_IO_BLOCK_SIZE))
+          input->endBlock = FFMIN(input->endBlock, block + 1);
+        SDL_CondBroadcast (input->cond);
+        }
+      SDL_UnlockMutex (input->mutex);
+
+      return 0;
+      }
+    //}}}
+    //{{{
+    int readAt (int64_t block, uint8_t* buf) {
+    // whole block, short only at the end of the file
+
+      int64_t offset = block * ASYNC_IO_BLOCK_SIZE;
+      int len = 0;
+
+    #if HAVE_UNISTD_H && !defined(_WIN32)
+      if (local) {
+        while (len < ASYNC_IO_BLOCK_SIZE) {
+          ssize_t ret = pread (fd, buf + len, ASYNC_IO_BLOCK_SIZE - len, offset + len);
+          if (ret < 0 && errno == EINTR)
+            continue;
+          if (ret < 0)
+            return AVERROR (errno);
+          if (ret == 0)
+            break;
+          len += (int)ret;
+          }
+        return len;
+        }
+    #endif
+
+      // a url has the one worker, its position is only moved here
+      if (avio_tell (source) != offset) {
+        int64_t ret = avio_seek (source, offset, SEEK_SET);
+        if (ret < 0)
+          return (int)ret;
+        }
+      len = avio_read (source, buf, ASYNC_IO_BLOCK_SIZE);
+      return len == AVERROR_EOF ? 0 : len;
+      }
+    //}}}
+
+    AVIOContext* ioContext;
+    AVIOContext* source;
+    AVIOInterruptCB interrupt;
+    bool local;
+    int fd;
+    int64_t size;
+
+    SDL_mutex* mutex;
+    SDL_cond* cond;
+    SDL_Thread* workers[ASYNC_IO_MAX_THREADS];
+    int numWorkers;
+    bool quit;
+
+    uint8_t* blocks;
+    sSlot slots[ASYNC_IO_BLOCKS];
+    int64_t pos;         // the demuxer read position
+    int64_t readBlock;   // the block pos is in, the start of the window
+    int64_t fetchBlock;  // the next block to claim
+    int64_t endBlock;    // past the last block, once a short read has found it
+
+    int64_t blocksRead;
+    int64_t stalls;
+    };
+  //}}}
+  //}}}
+  //{{{  keyframe index
+  //{{{
+  struct sKeyframe {
+    int64_t pts;  // AV_TIME_BASE
+    int64_t pos;  // byte offset of its packet
+    };
+  //}}}
+  //{{{
+  class cKeyframeIndex {
+  // pts to byte offset table of one stream's keyframes, for demuxers with no index of their own
+  // - built on its own thread with its own demuxer, or loaded from a .kidx in the user's cache keyed by size and mtime
+  // - usable while it is still being built, for targets it has already passed
+  // - a pts going backwards, a discontinuity or wrap, gives the index up, seeks fall back to avformat
+  public:
+    //{{{
+    int open (const char* newFilename, const AVInputFormat* newFormat, int newStreamIndex, enum AVCodecID newCodecId) {
+
+    #if HAVE_UNISTD_H && !defined(_WIN32)
+      const char* path = newFilename;
+      const char* protocol = avio_find_protocol_name (newFilename);
+      if (!protocol || strcmp (protocol, "file") || !strcmp (newFilename, "-"))
+        return AVERROR (ENOSYS);
+      av_strstart (newFilename, "file:", &path);
+
+      struct stat st;
+      if (stat (path, &st) < 0 || !S_ISREG (st.st_mode))
+        return AVERROR (ENOSYS);
+
+      fileSize = st.st_size;
+      fileTime = st.st_mtime;
+      filename = av_strdup (newFilename);
+      cacheUrl = getCachePath (path);
+      mutex = SDL_CreateMutex();
+      if (!filename || !mutex) {
+        //{{{  error return
+        close();
+        return AVERROR (ENOMEM);
+        }
+        //}}}
+
+      format = newFormat;
+      streamIndex = newStreamIndex;
+      codecId = newCodecId;
+
+      if (cacheUrl && (load() >= 0)) {
+        av_log (NULL, AV_LOG_VERBOSE, "Loaded %d keyframes from %s\n", numKeyframes, cacheUrl);
+        finished = true;
+        return 0;
+        }
+
+      if (!(thread = SDL_CreateThread (indexThread, "index", this))) {
+        //{{{  error return
+        av_log (NULL, AV_LOG_WARNING, "SDL_CreateThread(): %s\n", SDL_GetError());
+        close();
+        return AVERROR (ENOMEM);
+        }
+        //}}}
+
+      return 0;
+    #else
+      return AVERROR (ENOSYS);
+    #endif
+      }
+    //}}}
+    //{{{
+    void close() {
+
+      if (thread) {
+        SDL_AtomicSet (&quit, 1);
+        SDL_WaitThread (thread, NULL);
+        }
+      thread = NULL;
+
+      av_freep (&keyframes);
+      numKeyframes = 0;
+      allocatedSize = 0;
+      av_freep (&filename);
+      av_freep (&cacheUrl);
+      if (mutex)
+        SDL_DestroyMutex (mutex);
+      mutex = NULL;
+      }
+    //}}}
+
+    //{{{
+    bool isUsable() {
+    // worth a time seek instead of a guessed byte seek
+
+      if (!mutex)
+        return false;
+
+      SDL_LockMutex (mutex);
+      bool usable = !broken && numKeyframes > 0;
+      SDL_UnlockMutex (mutex);
+      return usable;
+      }
+    //}}}
+    //{{{
+    bool find (int64_t target, int64_t min, int64_t max, int64_t* pts, int64_t* pos) {
+    // the last keyframe at or before target, else the first after it, within min..max
+
+      if (!mutex)
+        return false;
+
+      SDL_LockMutex (mutex);
+
+      bool found = false;
+      // past the end of an index still being built, the keyframe before target may not be in it yet
+      if (!broken && numKeyframes > 0 && (finished || target <= keyframes[numKeyframes-1].pts)) {
+        int lo = 0;
+        int hi = numKeyframes;
+        while (lo < hi) {
+          int mid = (lo + hi) / 2;
+          if (keyframes[mid].pts <= target)
+            lo = mid + 1;
+          else
+            hi = mid;
+          }
+
+        int i = lo - 1;
+        if (i < 0 || keyframes[i].pts < min)
+          i++;
+        if (i < numKeyframes && keyframes[i].pts >= min && keyframes[i].pts <= max) {
+          *pts = keyframes[i].pts;
+          *pos = keyframes[i].pos;
+          found = true;
+          }
+        }
+
+      SDL_UnlockMutex (mutex);
+      return found;
+      }
+    //}}}
+
+  private:
+    //{{{
+    static int interruptCallback (void* ctx) {
+      return SDL_AtomicGet (&((cKeyframeIndex*)ctx)->quit);
+      }
+    //}}}
+    //{{{
+    static int indexThread (void* arg) {
+
+      gTrace.setThreadName ("index");
+      cKeyframeIndex* index = (cKeyframeIndex*)arg;
+      SDL_SetThreadPriority (SDL_THREAD_PRIORITY_LOW);
+
+      int64_t startTime = av_gettime_relative();
+      AVPacket* pkt = av_packet_alloc();
+      AVFormatContext* formatContext = avformat_alloc_context();
+      if (!pkt || !formatContext) {
+        //{{{  error return
+        av_packet_free (&pkt);
+        avformat_free_context (formatContext);
+        return 0;
+        }
+        //}}}
+
+      formatContext->interrupt_callback.callback = interruptCallback;
+      formatContext->interrupt_callback.opaque = index;
+      int ret = avformat_open_input (&formatContext, index->filename, index->format, NULL);
+      if (ret < 0) {
+        //{{{  error return
+        print_error (index->filename, ret);
+        av_packet_free (&pkt);
+        return 0;
+        }
+        //}}}
+
+      // the player's demuxer did the same open, so the streams come up in the same order
+      bool ok = true;
+      while (ok && !SDL_AtomicGet (&index->quit) && (ret = av_read_frame (formatContext, pkt)) >= 0) {
+        for (unsigned i = 0; i < formatContext->nb_streams; i++)
+          if ((int)i != index->streamIndex)
+            formatContext->streams[i]->discard = AVDISCARD_ALL;
+
+        if (pkt->stream_index == index->streamIndex && (pkt->flags & AV_PKT_FLAG_KEY) && pkt->pos >= 0) {
+          AVStream* stream = formatContext->streams[pkt->stream_index];
+          int64_t ts = pkt->pts != AV_NOPTS_VALUE ? pkt->pts : pkt->dts;
+          if (stream->codecpar->codec_id != index->codecId)
+            ok = false;
+          else if (ts != AV_NOPTS_VALUE)
+            ok = index->add (av_rescale_q (ts, stream->time_base, { 1, AV_TIME_BASE }), pkt->pos) >= 0;
+          }
+        av_packet_unref (pkt);
+        }
+
+      avformat_close_input (&formatContext);
+      av_packet_free (&pkt);
+
+      if (ok && ret == AVERROR_EOF) {
+        SDL_LockMutex (index->mutex);
+        index->finished = true;
+        SDL_UnlockMutex (index->mutex);
+        av_log (NULL, AV_LOG_VERBOSE, "Indexed %d keyframes of %s in %.3fs\n",
+                index->numKeyframes, index->filename, (av_gettime_relative() - startTime) / 1000000.0);
+        index->save();
+        }
+      else if (!ok) {
+        SDL_LockMutex (index->mutex);
+        index->broken = true;
+        SDL_UnlockMutex (index->mutex);
+        av_log (NULL, AV_LOG_VERBOSE, "%s: keyframes not indexable, seeking without the index\n", index->filename);
+        }
+
+      return 0;
+      }
+    //}}}
+    //{{{
+    int add (int64_t pts, int64_t pos) {
+
+      SDL_LockMutex (mutex);
+
+      int ret = 0;
+      if (numKeyframes > 0 && pts <= keyframes[numKeyframes-1].pts)
+        ret = AVERROR_INVALIDDATA;
+      else {
+        sKeyframe* newKeyframes = (sKeyframe*)av_fast_realloc (keyframes, &allocatedSize, (numKeyframes + 1) * sizeof(sKeyframe));
+        if (!newKeyframes)
+          ret = AVERROR (ENOMEM);
+        else {
+          keyframes = newKeyframes;
+          keyframes[numKeyframes].pts = pts;
+          keyframes[numKeyframes].pos = pos;
+          numKeyframes++;
+          }
+        }
+
+      SDL_UnlockMutex (mutex);
+      return ret;
+      }
+    //}}}
+
+    //{{{
+    int load() {
+
+      AVIOContext* pb = NULL;
+      int ret = avio_open2 (&pb, cacheUrl, AVIO_FLAG_READ, NULL, NULL);
+      if (ret < 0)
+        return ret;
+
+      if ((avio_rl32 (pb) != KIDX_TAG) ||
+          (avio_rl32 (pb) != KIDX_VERSION) ||
+          ((int64_t)avio_rl64 (pb) != fileSize) ||
+          ((int64_t)avio_rl64 (pb) != fileTime) ||
+          ((int)avio_rl32 (pb) != streamIndex) ||
+          ((enum AVCodecID)avio_rl32 (pb) != codecId)) {
+        //{{{  error return, a stale or foreign cache
+        avio_closep (&pb);
+        return AVERROR_INVALIDDATA;
+        }
+        //}}}
+
+      unsigned count = avio_rl32 (pb);
+      if (count == 0 || count > INT_MAX / sizeof(sKeyframe) ||
+          avio_size (pb) != KIDX_HEADER_SIZE + (int64_t)count * KIDX_ENTRY_SIZE) {
+        //{{{  error return
+        avio_closep (&pb);
+        return AVERROR_INVALIDDATA;
+        }
+        //}}}
+
+      keyframes = (sKeyframe*)av_malloc_array (count, sizeof(sKeyframe));
+      if (!keyframes) {
+        //{{{  error return
+        avio_closep (&pb);
+        return AVERROR (ENOMEM);
+        }
+        //}}}
+
+      allocatedSize = count * sizeof(sKeyframe);
+      for (numKeyframes = 0; numKeyframes < (int)count; numKeyframes++) {
+        keyframes[numKeyframes].pts = avio_rl64 (pb);
+        keyframes[numKeyframes].pos = avio_rl64 (pb);
+        }
+
+      ret = pb->error;
+      avio_closep (&pb);
+      if (ret < 0)
+        numKeyframes = 0;
+      return ret;
+      }
+    //}}}
+    //{{{
+    static char* getCachePath (const char* path) {
+    // $XDG_CACHE_HOME/ffplay/<hash of the absolute path>.kidx, else under ~/.cache, NULL with neither
+
+    #if HAVE_UNISTD_H && !defined(_WIN32)
+      char* absPath = realpath (path, NULL);
+      if (!absPath)
+        return NULL;
+
+      // fnv-1a, the header tells a collision apart by size, mtime, stream and codec
+      uint64_t hash = 0xcbf29ce484222325ULL;
+      for (const char* c = absPath; *c; c++)
+        hash = (hash ^ (uint8_t)*c) * 0x100000001b3ULL;
+      free (absPath);
+
+      const char* cacheHome = getenv ("XDG_CACHE_HOME");
+      if (cacheHome && *cacheHome)
+        return av_asprintf ("%s/ffplay/%016" PRIx64 ".kidx", cacheHome, hash);
+      const char* home = getenv ("HOME");
+      if (home && *home)
+        return av_asprintf ("%s/.cache/ffplay/%016" PRIx64 ".kidx", home, hash);
+    #endif
+      return NULL;
+      }
+    //}}}
+    //{{{
+    void save() {
+    // best effort, written aside and renamed over, so players indexing the same file never interleave
+
+    #if HAVE_UNISTD_H && !defined(_WIN32)
+      if (!cacheUrl)
+        return;
+
+      // the ffplay directory, and the cache directory above it on a first run
+      char* dir = av_strdup (cacheUrl);
+      if (!dir)
+        return;
+      *strrchr (dir, '/') = '\0';
+      char* parent = strrchr (dir, '/');
+      if (parent) {
+        *parent = '\0';
+        mkdir (dir, 0700);
+        *parent = '/';
+        }
+      mkdir (dir, 0700);
+      av_free (dir);
+
+      char* tempUrl = av_asprintf ("%s.%d.tmp", cacheUrl, (int)getpid());
+      if (!tempUrl)
+        return;
+
+      AVIOContext* pb = NULL;
+      if (avio_open2 (&pb, tempUrl, AVIO_FLAG_WRITE, NULL, NULL) < 0) {
+        av_free (tempUrl);
+        return;
+        }
+
+      avio_wl32 (pb, KIDX_TAG);
+      avio_wl32 (pb, KIDX_VERSION);
+      avio_wl64 (pb, fileSize);
+      avio_wl64 (pb, fileTime);
+      avio_wl32 (pb, streamIndex);
+      avio_wl32 (pb, codecId);
+      avio_wl32 (pb, numKeyframes);
+      for (int i = 0; i < numKeyframes; i++) {
+        avio_wl64 (pb, keyframes[i].pts);
+        avio_wl64 (pb, keyframes[i].pos);
+        }
+      avio_flush (pb);
+      int ret = pb->error;
+      if ((avio_closep (&pb) < 0) || (ret < 0) || (rename (tempUrl, cacheUrl) < 0))
+        unlink (tempUrl);
+      av_free (tempUrl);
+    #endif
+      }
+    //}}}
+
+    char* filename;
+    char* cacheUrl;
+    const AVInputFormat* format;
+    int streamIndex;
+    enum AVCodecID codecId;
+    int64_t fileSize;
+    int64_t fileTime;
+
+    SDL_Thread* thread;
+    SDL_atomic_t quit;
+
+    SDL_mutex* mutex;
+    sKeyframe* keyframes;
+    unsigned allocatedSize;
+    int numKeyframes;
+    bool finished;
+    bool broken;
+    };
+  //}}}
+  //}}}
+  //{{{  video
+  //{{{
+  int computeMod (int a, int b) {
+    return a < 0 ? a%b + b : a%b;
+    }
+  //}}}
+
+  //{{{
+  void calculateDisplayRect (SDL_Rect* rect,
+                             int scr_xleft, int scr_ytop, int scr_width, int scr_height,
+                             int pic_width, int pic_height, AVRational pic_sar) {
+
+    AVRational aspect_ratio = pic_sar;
+
+    if (av_cmp_q (aspect_ratio, av_make_q (0, 1)) <= 0)
+      aspect_ratio = av_make_q (1, 1);
+
+    aspect_ratio = av_mul_q (aspect_ratio, av_make_q(pic_width, pic_height));
+
+    /* XXX: we suppose the screen has a 1.0 pixel ratio */
+    int height = scr_height;
+    int width = av_rescale (height, aspect_ratio.num, aspect_ratio.den) & ~1;
+    if (width > scr_width) {
+      width = scr_width;
+      height = av_rescale (width, aspect_ratio.den, aspect_ratio.num) & ~1;
+      }
+
+    int x = (scr_width - width) / 2;
+    int y = (scr_height - height) / 2;
+    rect->x = scr_xleft + x;
+    rect->y = scr_ytop  + y;
+    rect->w = FFMAX((int)width,  1);
+    rect->h = FFMAX((int)height, 1);
+    }
+  //}}}
+  //{{{
+  void set_default_window_size (int width, int height, AVRational sar) {
+
+    SDL_Rect rect;
+    int max_width  = screen_width  ? screen_width  : INT_MAX;
+    int max_height = screen_height ? screen_height : INT_MAX;
+    if (max_width == INT_MAX && max_height == INT_MAX)
+      max_height = height;
+
+    calculateDisplayRect (&rect, 0, 0, max_width, max_height, width, height, sar);
+
+    default_width = rect.w;
+    default_height = rect.h;
+    }
+  //}}}
+
+  //{{{
+  void drawRectangle (int x, int y, int width, int height) {
+
+    SDL_Rect rect;
+    rect.x = x;
+    rect.y = y;
+    rect.w = width;
+    rect.h = height;
+
+    if (width && height)
+      SDL_RenderFillRect (gRenderer, &rect);
+    }
+  //}}}
+
+  //{{{
+  void pushRefreshEvent() {
+  // wake the eventLoop, keeping at most one refresh event in the SDL queue
+
+    if (SDL_AtomicCAS (&gRefreshEventPending, 0, 1)) {
+      SDL_Event event;
+      event.type = FF_REFRESH_EVENT;
+      SDL_PushEvent (&event);
+      }
+    }
+  //}}}
+
+  //{{{
+  void setSdlYuvConversionMode (AVFrame* frame) {
+
+    SDL_YUV_CONVERSION_MODE mode = SDL_YUV_CONVERSION_AUTOMATIC;
+
+    if (frame && (frame->format == AV_PIX_FMT_YUV420P
+                  || frame->format == AV_PIX_FMT_YUYV422
+                  || frame->format == AV_PIX_FMT_UYVY422
+                  || frame->format == AV_PIX_FMT_NV12
+                  || frame->format == AV_PIX_FMT_NV21
+                  || frame->format == AV_PIX_FMT_P010
+                  || frame->format == AV_PIX_FMT_YUV420P10)) {
+      if (frame->color_range == AVCOL_RANGE_JPEG)
+         mode = SDL_YUV_CONVERSION_JPEG;
+      else if (frame->colorspace == AVCOL_SPC_BT709)
+        mode = SDL_YUV_CONVERSION_BT709;
+      else if (frame->colorspace == AVCOL_SPC_BT470BG || frame->colorspace == AVCOL_SPC_SMPTE170M)
+        mode = SDL_YUV_CONVERSION_BT601;
+      }
+
+    SDL_SetYUVConversionMode (mode); /* FIXME: no support for linear transfer */
+    }
+  //}}}
+  //{{{
+  void getSdlPixfmtAndBlendmode (int format, Uint32* sdl_pix_fmt, SDL_BlendMode* sdl_blendmode) {
+
+    *sdl_blendmode = SDL_BLENDMODE_NONE;
+    if (format == AV_PIX_FMT_RGB32   ||
+        format == AV_PIX_FMT_RGB32_1 ||
+        format == AV_PIX_FMT_BGR32   ||
+        format == AV_PIX_FMT_BGR32_1)
+      *sdl_blendmode = SDL_BLENDMODE_BLEND;
+
+    *sdl_pix_fmt = SDL_PIXELFORMAT_UNKNOWN;
+    for (int i = 0; i < FF_ARRAY_ELEMS (sdlTextureFormatMap) - 1; i++) {
+      if (format == sdlTextureFormatMap[i].format) {
+        *sdl_pix_fmt = sdlTextureFormatMap[i].texture_fmt;
+        return;
+        }
+      }
+    }
+  //}}}
+
+  //{{{
+  int reallocTexture (SDL_Texture** texture, Uint32 new_format,
+                              int new_width, int new_height, SDL_BlendMode blendmode, int initTexture) {
+
+    Uint32 format;
+    int access, w, h;
+    if (!*texture
+        || SDL_QueryTexture (*texture, &format, &access, &w, &h) < 0
+        || new_width != w || new_height != h
+        || new_format != format) {
+
+      if (*texture)
+        SDL_DestroyTexture (*texture);
+
+      if (!(*texture = SDL_CreateTexture (gRenderer, new_format, SDL_TEXTUREACCESS_STREAMING, new_width, new_height)))
+        return -1;
+
+      if (SDL_SetTextureBlendMode (*texture, blendmode) < 0)
+        return -1;
+
+      if (initTexture) {
+        void* pixels;
+        int pitch;
+        if (SDL_LockTexture (*texture, NULL, &pixels, &pitch) < 0)
+          return -1;
+
+        memset (pixels, 0, pitch * new_height);
+        SDL_UnlockTexture (*texture);
+        }
+
+      av_log (NULL, AV_LOG_VERBOSE, "Created %dx%d texture with %s.\n", new_width, new_height, SDL_GetPixelFormatName(new_format));
+      }
+
+    return 0;
+    }
+  //}}}
+  //{{{
+  void downconvertRow (uint8_t* dst, const uint16_t* src, int count, int shift) {
+  // round 16 bit samples down to 8 bit, shift 2 for lsb aligned 10 bit, 8 for msb aligned P010
+
+    int i = 0;
+
+    #if defined(__AVX2__)
+      const __m256i round = _mm256_set1_epi16 ((short)(1 << (shift - 1)));
+      const __m128i shift128 = _mm_cvtsi32_si128 (shift);
+      for (; i + 32 <= count; i += 32) {
+        __m256i a = _mm256_loadu_si256 ((const __m256i*)(src + i));
+        __m256i b = _mm256_loadu_si256 ((const __m256i*)(src + i + 16));
+        a = _mm256_srl_epi16 (_mm256_adds_epu16 (a, round), shift128);
+        b = _mm256_srl_epi16 (_mm256_adds_epu16 (b, round), shift128);
+        // packus works per 128 bit lane, permute the lanes back into order
+        _mm256_storeu_si256 ((__m256i*)(dst + i), _mm256_permute4x64_epi64 (_mm256_packus_epi16 (a, b), 0xD8));
+        }
+    #elif defined(__SSE2__) || defined(_M_X64)
+      const __m128i round = _mm_set1_epi16 ((short)(1 << (shift - 1)));
+      const __m128i shift128 = _mm_cvtsi32_si128 (shift);
+      for (; i + 16 <= count; i += 16) {
+        __m128i a = _mm_loadu_si128 ((const __m128i*)(src + i));
+        __m128i b = _mm_loadu_si128 ((const __m128i*)(src + i + 8));
+        a = _mm_srl_epi16 (_mm_adds_epu16 (a, round), shift128);
+        b = _mm_srl_epi16 (_mm_adds_epu16 (b, round), shift128);
+        _mm_storeu_si128 ((__m128i*)(dst + i), _mm_packus_epi16 (a, b));
+        }
+    #elif defined(__ARM_NEON)
+      const uint16x8_t round = vdupq_n_u16 ((uint16_t)(1 << (shift - 1)));
+      const int16x8_t rshift = vdupq_n_s16 ((int16_t)-shift);
+      for (; i + 16 <= count; i += 16) {
+        uint16x8_t a = vshlq_u16 (vqaddq_u16 (vld1q_u16 (src + i), round), rshift);
+        uint16x8_t b = vshlq_u16 (vqaddq_u16 (vld1q_u16 (src + i + 8), round), rshift);
+        vst1q_u8 (dst + i, vcombine_u8 (vqmovn_u16 (a), vqmovn_u16 (b)));
+        }
+    #endif
+
+    for (; i < count; i++)
+      dst[i] = (uint8_t)FFMIN((src[i] + (1 << (shift - 1))) >> shift, 255);
+    }
+  //}}}
+  //{{{
+  void getLockedTexturePlanes (Uint32 sdlPixelFormat, uint8_t* pixels, int pitch, int height,
+                               uint8_t* planes[3], int pitches[3]) {
+  // SDL locks YUV textures as one block, chroma planes follow the luma plane
+
+    planes[0] = pixels;
+    pitches[0] = pitch;
+    planes[1] = planes[2] = NULL;
+    pitches[1] = pitches[2] = 0;
+
+    switch (sdlPixelFormat) {
+      case SDL_PIXELFORMAT_IYUV:
+        pitches[1] = pitches[2] = (pitch + 1) / 2;
+        planes[1] = pixels + height * pitch;
+        planes[2] = planes[1] + ((height + 1) / 2) * pitches[1];
+        break;
+
+      case SDL_PIXELFORMAT_NV12:
+      case SDL_PIXELFORMAT_NV21:
+        pitches[1] = 2 * ((pitch + 1) / 2);
+        planes[1] = pixels + height * pitch;
+        break;
+
+      default:
+        break;
+      }
+    }
+  //}}}
+  //{{{
+  class cSlicePool {
+  // persistent workers sharing the slices of one job with the calling thread
+  // - run returns once every slice is done and every woken worker is idle again
+  public:
+    //{{{
+    int init (int threads) {
+
+      startSem = SDL_CreateSemaphore (0);
+      doneSem = SDL_CreateSemaphore (0);
+      if (!startSem || !doneSem) {
+        av_log (NULL, AV_LOG_FATAL, "SDL_CreateSemaphore(): %s\n", SDL_GetError());
+        return AVERROR(ENOMEM);
+        }
+
+      SDL_AtomicSet (&quit, 0);
+      for (int i = 0; i < FFMIN(threads, MAX_UPLOAD_THREADS); i++) {
+        if (!(workers[numWorkers] = SDL_CreateThread (workerThread, "upload", this))) {
+          av_log (NULL, AV_LOG_WARNING, "SDL_CreateThread(): %s\n", SDL_GetError());
+          break;
+          }
+        numWorkers++;
+        }
+
+      av_log (NULL, AV_LOG_VERBOSE, "Started %d upload threads\n", numWorkers);
+      return 0;
+      }
+    //}}}
+    //{{{
+    void exit() {
+
+      SDL_AtomicSet (&quit, 1);
+      for (int i = 0; i < numWorkers; i++)
+        SDL_SemPost (startSem);
+      for (int i = 0; i < numWorkers; i++)
+        SDL_WaitThread (workers[i], NULL);
+      numWorkers = 0;
+
+      if (startSem)
+        SDL_DestroySemaphore (startSem);
+      if (doneSem)
+        SDL_DestroySemaphore (doneSem);
+      startSem = doneSem = NULL;
+      }
+    //}}}
+
+    int getNumWorkers() { return numWorkers; }
+
+    //{{{
+    void run (void (*newSliceFunc)(void* arg, int slice, int numSlices), void* newArg, int newNumSlices) {
+
+      sliceFunc = newSliceFunc;
+      arg = newArg;
+      numSlices = newNumSlices;
+
+      int wake = FFMIN(numWorkers, numSlices - 1);
+      SDL_AtomicSet (&pending, numSlices + wake);
+      SDL_AtomicSet (&nextSlice, 0);
+      for (int i = 0; i < wake; i++)
+        SDL_SemPost (startSem);
+
+      runSlices();
+
+      // barrier, the last slice or worker to finish posts
+      SDL_SemWait (doneSem);
+      }
+    //}}}
+
+  private:
+    //{{{
+    void runSlices() {
+
+      int slice;
+      while ((slice = SDL_AtomicAdd (&nextSlice, 1)) < numSlices) {
+        sliceFunc (arg, slice, numSlices);
+        done();
+        }
+      }
+    //}}}
+    //{{{
+    void done() {
+      if (SDL_AtomicAdd (&pending, -1) == 1)
+        SDL_SemPost (doneSem);
+      }
+    //}}}
+    //{{{
+    static int workerThread (void* arg) {
+
+      cSlicePool* pool = (cSlicePool*)arg;
+      for (;;) {
+        SDL_SemWait (pool->startSem);
+        if (SDL_AtomicGet (&pool->quit))
+          return 0;
+
+        pool->runSlices();
+        pool->done();
+        }
+      }
+    //}}}
+
+    SDL_Thread* workers[MAX_UPLOAD_THREADS];
+    int numWorkers;
+
+    SDL_sem* startSem;
+    SDL_sem* doneSem;
+    SDL_atomic_t quit;
+
+    void (*sliceFunc)(void* arg, int slice, int numSlices);
+    void* arg;
+    int numSlices;
+
+    SDL_atomic_t nextSlice;
+    SDL_atomic_t pending;
+    };
+  //}}}
+  static cSlicePool gUploadPool;
+
+  //{{{
+  struct sUploadJob {
+    int height;
+    int numPlanes;
+    int chromaShift;
+    int downShift;
+
+    uint8_t* dst[3];
+    int dstPitch[3];
+
+    const uint8_t* src[3];
+    int srcPitch[3];
+
+    int rowBytes[3];
+    };
+  //}}}
+  //{{{
+  void uploadSlice (void* arg, int slice, int numSlices) {
+  // copy one band of rows of every plane, band edges fall on even luma rows so chroma splits cleanly
+
+    sUploadJob* job = (sUploadJob*)arg;
+
+    int y0 = (int)((int64_t)job->height * slice / numSlices) & ~1;
+    int y1 = (slice == numSlices - 1) ? job->height : (int)((int64_t)job->height * (slice + 1) / numSlices) & ~1;
+
+    for (int plane = 0; plane < job->numPlanes; plane++) {
+      int shift = plane ? job->chromaShift : 0;
+      for (int y = y0 >> shift; y < AV_CEIL_RSHIFT(y1, shift); y++) {
+        uint8_t* dst = job->dst[plane] + y * job->dstPitch[plane];
+        const uint8_t* src = job->src[plane] + y * job->srcPitch[plane];
+        if (job->downShift)
+          downconvertRow (dst, (const uint16_t*)src, job->rowBytes[plane], job->downShift);
+        else
+          memcpy (dst, src, job->rowBytes[plane]);
+        }
+      }
+    }
+  //}}}
+  //{{{
+  int uploadTextureLocked (SDL_Texture* tex, Uint32 textureFormat, AVFrame* frame) {
+  // write the frame planes straight into the locked texture, in slices on gUploadPool when it runs
+  // - high bit depth planes are downconverted on the way, no swscale pass
+  // - negative linesizes are copied in memory order, drawVideoDisplay flips them
+
+    sUploadJob job;
+    job.height = frame->height;
+    job.chromaShift = 0;
+    job.downShift = (frame->format == AV_PIX_FMT_P010) ? 8 : (frame->format == AV_PIX_FMT_YUV420P10) ? 2 : 0;
+
+    switch (textureFormat) {
+      case SDL_PIXELFORMAT_IYUV:
+        job.numPlanes = 3;
+        job.chromaShift = 1;
+        job.rowBytes[0] = frame->width;
+        job.rowBytes[1] = job.rowBytes[2] = AV_CEIL_RSHIFT(frame->width, 1);
+        break;
+
+      case SDL_PIXELFORMAT_NV12:
+      case SDL_PIXELFORMAT_NV21:
+        job.numPlanes = 2;
+        job.chromaShift = 1;
+        job.rowBytes[0] = frame->width;
+        job.rowBytes[1] = 2 * AV_CEIL_RSHIFT(frame->width, 1);
+        break;
+
+      default:
+        job.numPlanes = 1;
+        job.rowBytes[0] = frame->width * SDL_BYTESPERPIXEL(textureFormat);
+        break;
+      }
+
+    int positive = 0;
+    for (int plane = 0; plane < job.numPlanes; plane++) {
+      int height = plane ? AV_CEIL_RSHIFT(frame->height, job.chromaShift) : frame->height;
+      job.src[plane] = frame->data[plane];
+      job.srcPitch[plane] = frame->linesize[plane];
+      if (job.srcPitch[plane] < 0) {
+        job.src[plane] += job.srcPitch[plane] * (height - 1);
+        job.srcPitch[plane] = -job.srcPitch[plane];
+        }
+      else
+        positive++;
+      }
+    if (positive && (positive != job.numPlanes)) {
+      av_log (NULL, AV_LOG_ERROR, "Mixed negative and positive linesizes are not supported.\n");
+      return -1;
+      }
+
+    uint8_t* pixels;
+    int pitch;
+    if (SDL_LockTexture (tex, NULL, (void**)&pixels, &pitch) < 0)
+      return -1;
+    getLockedTexturePlanes (textureFormat, pixels, pitch, frame->height, job.dst, job.dstPitch);
+
+    int numSlices = FFMIN(gUploadPool.getNumWorkers() + 1, frame->height / MIN_UPLOAD_SLICE_ROWS);
+    if (numSlices > 1)
+      gUploadPool.run (uploadSlice, &job, numSlices);
+    else
+      uploadSlice (&job, 0, 1);
+
+    SDL_UnlockTexture (tex);
+    return 0;
+    }
+  //}}}
+  //{{{
+  int uploadTexture (SDL_Texture** tex, AVFrame* frame) {
+
+    cTraceSpan span ("render", "uploadTexture");
+    Uint32 sdlPixelFormat;
+    SDL_BlendMode sdl_blendmode;
+    getSdlPixfmtAndBlendmode (frame->format, &sdlPixelFormat, &sdl_blendmode);
+
+    if (reallocTexture (tex,
+      sdlPixelFormat == SDL_PIXELFORMAT_UNKNOWN ? SDL_PIXELFORMAT_ARGB8888 : sdlPixelFormat,
+                        frame->width, frame->height, sdl_blendmode, 0) < 0)
+      return -1;
+
+    // sliced upload needs every plane in the one locked block, downconverted formats always take it
+    if (gUploadPool.getNumWorkers()
+        || (frame->format == AV_PIX_FMT_P010)
+        || (frame->format == AV_PIX_FMT_YUV420P10))
+      return uploadTextureLocked (*tex,
+        sdlPixelFormat == SDL_PIXELFORMAT_UNKNOWN ? (Uint32)SDL_PIXELFORMAT_ARGB8888 : (Uint32)sdlPixelFormat, frame);
+
+    int ret = 0;
+    switch (sdlPixelFormat) {
+      case SDL_PIXELFORMAT_IYUV:
+        if ((frame->linesize[0] > 0) && (frame->linesize[1] > 0) && (frame->linesize[2] > 0))
+          ret = SDL_UpdateYUVTexture (*tex, NULL,
+                                      frame->data[0], frame->linesize[0],
+                                      frame->data[1], frame->linesize[1],
+                                      frame->data[2], frame->linesize[2]);
+        else if ((frame->linesize[0] < 0) && (frame->linesize[1] < 0) && (frame->linesize[2] < 0))
+          ret = SDL_UpdateYUVTexture (*tex, NULL,
+                                      frame->data[0] + frame->linesize[0] * (frame->height - 1), -frame->linesize[0],
+                                      frame->data[1] + frame->linesize[1] * (AV_CEIL_RSHIFT(frame->height, 1) - 1), -frame->linesize[1],
+                                      frame->data[2] + frame->linesize[2] * (AV_CEIL_RSHIFT(frame->height, 1) - 1), -frame->linesize[2]);
+        else {
+          av_log (NULL, AV_LOG_ERROR, "Mixed negative and positive linesizes are not supported.\n");
+          return -1;
+          }
+        break;
+
+      case SDL_PIXELFORMAT_NV12:
+      case SDL_PIXELFORMAT_NV21:
+        if ((frame->linesize[0] > 0) && (frame->linesize[1] > 0))
+          ret = SDL_UpdateNVTexture (*tex, NULL,
+                                     frame->data[0], frame->linesize[0],
+                                     frame->data[1], frame->linesize[1]);
+        else if ((frame->linesize[0] < 0) && (frame->linesize[1] < 0))
+          ret = SDL_UpdateNVTexture (*tex, NULL,
+                                     frame->data[0] + frame->linesize[0] * (frame->height - 1), -frame->linesize[0],
+                                     frame->data[1] + frame->linesize[1] * (AV_CEIL_RSHIFT(frame->height, 1) - 1), -frame->linesize[1]);
+        else {
+          av_log (NULL, AV_LOG_ERROR, "Mixed negative and positive linesizes are not supported.\n");
+          return -1;
+          }
+        break;
+
+      default:
+        if (frame->linesize[0] < 0)
           ret = SDL_UpdateTexture (*tex, NULL,
                                    frame->data[0] + frame->linesize[0] * (frame->height - 1),
                                    -frame->linesize[0]);
@@ -464,12 +2272,423 @@ namespace {
         break;
       }
 
-    return ret;
-    }
+    return ret;
+    }
+  //}}}
+  //}}}
+  //{{{  thumbnail
+  //{{{
+  class cThumbnailer {
+  // scrub preview, keyframes decoded at the decoder's lowest resolution on their own thread and demuxer
+  // - requests are a mailbox, the latest wins and interrupts a stale one mid read
+  // - one thumbnail per THUMBNAIL_STEP of the timeline, kept as small textures in an LRU, textures only touched by the render thread
+  public:
+    //{{{
+    int open (const char* newFilename, const AVInputFormat* newFormat, int newStreamIndex, cKeyframeIndex* newIndex) {
+
+      filename = av_strdup (newFilename);
+      mutex = SDL_CreateMutex();
+      cond = SDL_CreateCond();
+      if (!filename || !mutex || !cond) {
+        //{{{  error return
+        close();
+        return AVERROR (ENOMEM);
+        }
+        //}}}
+
+      format = newFormat;
+      streamIndex = newStreamIndex;
+      keyframeIndex = newIndex;
+      requestBucket = -1;
+      servingSerial = 0;
+      SDL_AtomicSet (&requestSerial, 0);
+      SDL_AtomicSet (&quit, 0);
+      resultBucket = -1;
+      shownBucket = -1;
+      for (int i = 0; i < THUMBNAIL_CACHE_SIZE; i++)
+        cache[i].bucket = -1;
+
+      if (!(thread = SDL_CreateThread (thumbnailThread, "thumbnail", this))) {
+        //{{{  error return
+        av_log (NULL, AV_LOG_WARNING, "SDL_CreateThread(): %s\n", SDL_GetError());
+        close();
+        return AVERROR (ENOMEM);
+        }
+        //}}}
+
+      return 0;
+      }
+    //}}}
+    //{{{
+    void close() {
+
+      if (thread) {
+        SDL_LockMutex (mutex);
+        SDL_AtomicSet (&quit, 1);
+        SDL_CondSignal (cond);
+        SDL_UnlockMutex (mutex);
+        SDL_WaitThread (thread, NULL);
+        }
+      thread = NULL;
+
+      for (int i = 0; i < THUMBNAIL_CACHE_SIZE; i++) {
+        if (cache[i].texture)
+          SDL_DestroyTexture (cache[i].texture);
+        cache[i].texture = NULL;
+        cache[i].bucket = -1;
+        }
+
+      av_frame_free (&result);
+      av_freep (&filename);
+      if (cond)
+        SDL_DestroyCond (cond);
+      if (mutex)
+        SDL_DestroyMutex (mutex);
+      cond = NULL;
+      mutex = NULL;
+      }
+    //}}}
+
+    bool isOpen() { return thread != NULL; }
+
+    //{{{
+    void request (int64_t ts) {
+    // a cached thumbnail needs no decode
+
+      int64_t bucket = FFMAX(ts, 0) / THUMBNAIL_STEP;
+      for (int i = 0; i < THUMBNAIL_CACHE_SIZE; i++)
+        if (cache[i].bucket == bucket)
+          return;
+
+      SDL_LockMutex (mutex);
+      if (requestBucket != bucket) {
+        requestBucket = bucket;
+        SDL_AtomicIncRef (&requestSerial);
+        SDL_CondSignal (cond);
+        }
+      SDL_UnlockMutex (mutex);
+      }
+    //}}}
+    //{{{
+    SDL_Texture* getTexture (int64_t ts, int* w, int* h) {
+    // the thumbnail for ts, else the last one shown until it is decoded
+
+      takeResult();
+
+      int64_t bucket = FFMAX(ts, 0) / THUMBNAIL_STEP;
+      sEntry* found = NULL;
+      for (int i = 0; i < THUMBNAIL_CACHE_SIZE; i++) {
+        if (cache[i].bucket == bucket)
+          found = &cache[i];
+        else if (!found && cache[i].bucket == shownBucket)
+          found = &cache[i];
+        }
+      if (!found || (found->bucket < 0))
+        return NULL;
+
+      found->lastUsed = ++useCount;
+      shownBucket = found->bucket;
+      *w = found->width;
+      *h = found->height;
+      return found->texture;
+      }
+    //}}}
+    //{{{
+    bool hasResult() {
+
+      if (!mutex)
+        return false;
+
+      SDL_LockMutex (mutex);
+      bool has = resultBucket >= 0;
+      SDL_UnlockMutex (mutex);
+      return has;
+      }
+    //}}}
+
+  private:
+    //{{{
+    struct sEntry {
+      int64_t bucket;  // -1 empty
+      int64_t lastUsed;
+      SDL_Texture* texture;
+      int width;
+      int height;
+      };
+    //}}}
+    //{{{
+    static int interruptCallback (void* ctx) {
+    // a read for a target the user has already dragged past is abandoned
+
+      cThumbnailer* thumbnailer = (cThumbnailer*)ctx;
+      return SDL_AtomicGet (&thumbnailer->quit) || (SDL_AtomicGet (&thumbnailer->requestSerial) != thumbnailer->servingSerial);
+      }
+    //}}}
+    //{{{
+    static int thumbnailThread (void* arg) {
+
+      gTrace.setThreadName ("thumbnail");
+      cThumbnailer* thumbnailer = (cThumbnailer*)arg;
+      SDL_SetThreadPriority (SDL_THREAD_PRIORITY_LOW);
+
+      AVFormatContext* formatContext = avformat_alloc_context();
+      AVCodecContext* codecContext = NULL;
+      AVPacket* pkt = av_packet_alloc();
+      AVFrame* frame = av_frame_alloc();
+      struct SwsContext* swsContext = NULL;
+      if (!formatContext || !pkt || !frame)
+        goto done;
+
+      formatContext->interrupt_callback.callback = interruptCallback;
+      formatContext->interrupt_callback.opaque = thumbnailer;
+      if (avformat_open_input (&formatContext, thumbnailer->filename, thumbnailer->format, NULL) < 0)
+        goto done;
+      if ((thumbnailer->streamIndex >= (int)formatContext->nb_streams) && (avformat_find_stream_info (formatContext, NULL) < 0))
+        goto done;
+      if (thumbnailer->streamIndex >= (int)formatContext->nb_streams)
+        goto done;
+
+      {
+      AVStream* stream = formatContext->streams[thumbnailer->streamIndex];
+      const AVCodec* codec = avcodec_find_decoder (stream->codecpar->codec_id);
+      if (!codec || !(codecContext = avcodec_alloc_context3 (codec)) ||
+          (avcodec_parameters_to_context (codecContext, stream->codecpar) < 0))
+        goto done;
+
+      codecContext->pkt_timebase = stream->time_base;
+      codecContext->lowres = codec->max_lowres;
+      codecContext->skip_frame = AVDISCARD_NONKEY;
+      codecContext->thread_count = 1;
+      if (avcodec_open2 (codecContext, codec, NULL) < 0)
+        goto done;
+      for (unsigned i = 0; i < formatContext->nb_streams; i++)
+        if ((int)i != thumbnailer->streamIndex)
+          formatContext->streams[i]->discard = AVDISCARD_ALL;
+
+      SDL_LockMutex (thumbnailer->mutex);
+      while (!SDL_AtomicGet (&thumbnailer->quit)) {
+        if (SDL_AtomicGet (&thumbnailer->requestSerial) == thumbnailer->servingSerial) {
+          SDL_CondWait (thumbnailer->cond, thumbnailer->mutex);
+          continue;
+          }
+        thumbnailer->servingSerial = SDL_AtomicGet (&thumbnailer->requestSerial);
+        int64_t bucket = thumbnailer->requestBucket;
+        SDL_UnlockMutex (thumbnailer->mutex);
+
+        cTraceSpan span ("thumbnail", "decode");
+        int64_t ts = bucket * THUMBNAIL_STEP + THUMBNAIL_STEP / 2;
+        int64_t indexPts;
+        int64_t indexPos;
+        int ret;
+        if (thumbnailer->keyframeIndex->find (ts, INT64_MIN, INT64_MAX, &indexPts, &indexPos))
+          ret = avformat_seek_file (formatContext, -1, INT64_MIN, indexPos, INT64_MAX, AVSEEK_FLAG_BYTE);
+        else
+          ret = avformat_seek_file (formatContext, -1, INT64_MIN, ts, ts, 0);
+        avcodec_flush_buffers (codecContext);
+
+        // the first keyframe from there, a packet at a time so a newer request cuts it short
+        bool gotFrame = false;
+        for (int packets = 0; (ret >= 0) && !gotFrame && (packets < THUMBNAIL_MAX_PACKETS); ) {
+          if ((ret = av_read_frame (formatContext, pkt)) < 0)
+            break;
+          if (pkt->stream_index == thumbnailer->streamIndex) {
+            packets++;
+            if (avcodec_send_packet (codecContext, pkt) >= 0)
+              gotFrame = avcodec_receive_frame (codecContext, frame) >= 0;
+            }
+          av_packet_unref (pkt);
+          }
+        if ((ret == AVERROR_EOF) && !gotFrame && (avcodec_send_packet (codecContext, NULL) >= 0))
+          gotFrame = avcodec_receive_frame (codecContext, frame) >= 0;
+
+        AVFrame* thumbnail = gotFrame ? thumbnailer->scale (frame, &swsContext) : NULL;
+        av_frame_unref (frame);
+        span.end();
+
+        SDL_LockMutex (thumbnailer->mutex);
+        if (thumbnail) {
+          av_frame_free (&thumbnailer->result);
+          thumbnailer->result = thumbnail;
+          thumbnailer->resultBucket = bucket;
+          pushRefreshEvent();
+          }
+        }
+      SDL_UnlockMutex (thumbnailer->mutex);
+      }
+
+    done:
+      sws_freeContext (swsContext);
+      avcodec_free_context (&codecContext);
+      avformat_close_input (&formatContext);
+      av_packet_free (&pkt);
+      av_frame_free (&frame);
+      return 0;
+      }
+    //}}}
+    //{{{
+    AVFrame* scale (AVFrame* frame, struct SwsContext** swsContext) {
+    // to THUMBNAIL_WIDTH wide RGB32, square pixels
+
+      AVRational sar = frame->sample_aspect_ratio.num ? frame->sample_aspect_ratio : av_make_q (1, 1);
+      int height = (int)av_rescale (THUMBNAIL_WIDTH, (int64_t)frame->height * sar.den, (int64_t)frame->width * sar.num) & ~1;
+      if (frame->width <= 0 || height <= 0)
+        return NULL;
+
+      AVFrame* thumbnail = av_frame_alloc();
+      if (!thumbnail)
+        return NULL;
+      thumbnail->format = AV_PIX_FMT_RGB32;
+      thumbnail->width = THUMBNAIL_WIDTH;
+      thumbnail->height = FFMIN(height, THUMBNAIL_WIDTH * 2);
+
+      *swsContext = sws_getCachedContext (*swsContext, frame->width, frame->height, (AVPixelFormat)frame->format,
+                                          thumbnail->width, thumbnail->height, AV_PIX_FMT_RGB32,
+                                          SWS_BILINEAR, NULL, NULL, NULL);
+      if (!*swsContext || (av_frame_get_buffer (thumbnail, 0) < 0)) {
+        //{{{  error return
+        av_frame_free (&thumbnail);
+        return NULL;
+        }
+        //}}}
+
+      sws_scale (*swsContext, (const uint8_t* const*)frame->data, frame->linesize, 0, frame->height,
+                 thumbnail->data, thumbnail->linesize);
+      return thumbnail;
+      }
+    //}}}
+    //{{{
+    void takeResult() {
+    // upload a decoded thumbnail over the least recently used texture
+
+      SDL_LockMutex (mutex);
+      AVFrame* frame = result;
+      int64_t bucket = resultBucket;
+      result = NULL;
+      resultBucket = -1;
+      SDL_UnlockMutex (mutex);
+      if (!frame)
+        return;
+
+      sEntry* entry = &cache[0];
+      for (int i = 1; i < THUMBNAIL_CACHE_SIZE; i++)
+        if (cache[i].lastUsed < entry->lastUsed)
+          entry = &cache[i];
+
+      if (reallocTexture (&entry->texture, SDL_PIXELFORMAT_ARGB8888, frame->width, frame->height, SDL_BLENDMODE_NONE, 0) < 0 ||
+          SDL_UpdateTexture (entry->texture, NULL, frame->data[0], frame->linesize[0]) < 0)
+        entry->bucket = -1;
+      else {
+        entry->bucket = bucket;
+        entry->lastUsed = ++useCount;
+        entry->width = frame->width;
+        entry->height = frame->height;
+        }
+      av_frame_free (&frame);
+      }
+    //}}}
+
+    char* filename;
+    const AVInputFormat* format;
+    int streamIndex;
+    cKeyframeIndex* keyframeIndex;
+
+    SDL_Thread* thread;
+    SDL_mutex* mutex;
+    SDL_cond* cond;
+    SDL_atomic_t quit;
+
+    // under mutex, requestSerial is also read by the interrupt callback
+    int64_t requestBucket;
+    SDL_atomic_t requestSerial;
+    int servingSerial;  // thumbnail thread only
+    AVFrame* result;
+    int64_t resultBucket;
+
+    // render thread only
+    sEntry cache[THUMBNAIL_CACHE_SIZE];
+    int64_t useCount;
+    int64_t shownBucket;
+    };
   //}}}
   //}}}
   //{{{  audio
   //{{{
+  void applyVolumeS16 (int16_t* dst, const int16_t* src, int count, int volume) {
+  // dst = src * volume / SDL_MIX_MAXVOLUME, saturated, replaces memset + SDL_MixAudioFormat
+  // - the shift rounds toward -inf where SDL's divide truncates, at most 1 lsb apart
+
+    int i = 0;
+
+    #if defined(__AVX2__)
+      const __m256i gain = _mm256_set1_epi16 ((short)volume);
+      for (; i + 16 <= count; i += 16) {
+        __m256i a = _mm256_loadu_si256 ((const __m256i*)(src + i));
+        __m256i lo = _mm256_mullo_epi16 (a, gain);
+        __m256i hi = _mm256_mulhi_epi16 (a, gain);
+        // unpack and packs both work per 128 bit lane, so the order comes back out unchanged
+        __m256i p0 = _mm256_srai_epi32 (_mm256_unpacklo_epi16 (lo, hi), 7);
+        __m256i p1 = _mm256_srai_epi32 (_mm256_unpackhi_epi16 (lo, hi), 7);
+        _mm256_storeu_si256 ((__m256i*)(dst + i), _mm256_packs_epi32 (p0, p1));
+        }
+    #elif defined(__SSE2__) || defined(_M_X64)
+      const __m128i gain = _mm_set1_epi16 ((short)volume);
+      for (; i + 8 <= count; i += 8) {
+        __m128i a = _mm_loadu_si128 ((const __m128i*)(src + i));
+        __m128i lo = _mm_mullo_epi16 (a, gain);
+        __m128i hi = _mm_mulhi_epi16 (a, gain);
+        __m128i p0 = _mm_srai_epi32 (_mm_unpacklo_epi16 (lo, hi), 7);
+        __m128i p1 = _mm_srai_epi32 (_mm_unpackhi_epi16 (lo, hi), 7);
+        _mm_storeu_si128 ((__m128i*)(dst + i), _mm_packs_epi32 (p0, p1));
+        }
+    #elif defined(__ARM_NEON)
+      const int16x4_t gain = vdup_n_s16 ((int16_t)volume);
+      for (; i + 8 <= count; i += 8) {
+        int16x8_t a = vld1q_s16 (src + i);
+        int32x4_t p0 = vmull_s16 (vget_low_s16 (a), gain);
+        int32x4_t p1 = vmull_s16 (vget_high_s16 (a), gain);
+        vst1q_s16 (dst + i, vcombine_s16 (vqshrn_n_s32 (p0, 7), vqshrn_n_s32 (p1, 7)));
+        }
+    #endif
+
+    for (; i < count; i++)
+      dst[i] = (int16_t)av_clip_int16 ((src[i] * volume) >> 7);
+    }
+  //}}}
+  //{{{
+  void applyVolumeFlt (float* dst, const float* src, int count, int volume) {
+  // gain applied in the float domain, no saturation, SDL clamps float output itself
+
+    const float gain = volume / (float)SDL_MIX_MAXVOLUME;
+    int i = 0;
+
+    #if defined(__AVX2__)
+      const __m256 gain256 = _mm256_set1_ps (gain);
+      for (; i + 8 <= count; i += 8)
+        _mm256_storeu_ps (dst + i, _mm256_mul_ps (_mm256_loadu_ps (src + i), gain256));
+    #elif defined(__SSE2__) || defined(_M_X64)
+      const __m128 gain128 = _mm_set1_ps (gain);
+      for (; i + 4 <= count; i += 4)
+        _mm_storeu_ps (dst + i, _mm_mul_ps (_mm_loadu_ps (src + i), gain128));
+    #elif defined(__ARM_NEON)
+      for (; i + 4 <= count; i += 4)
+        vst1q_f32 (dst + i, vmulq_n_f32 (vld1q_f32 (src + i), gain));
+    #endif
+
+    for (; i < count; i++)
+      dst[i] = src[i] * gain;
+    }
+  //}}}
+  //{{{
+  void applyVolume (uint8_t* dst, const uint8_t* src, int len, enum AVSampleFormat fmt, int volume) {
+  // write len bytes of src into dst at volume, in one pass
+
+    if (fmt == AV_SAMPLE_FMT_FLT)
+      applyVolumeFlt ((float*)dst, (const float*)src, len / (int)sizeof(float), volume);
+    else
+      applyVolumeS16 ((int16_t*)dst, (const int16_t*)src, len / (int)sizeof(int16_t), volume);
+    }
+  //}}}
+  //{{{
   int compareAudioFormats (enum AVSampleFormat fmt1, int64_t channel_count1,
                                   enum AVSampleFormat fmt2, int64_t channel_count2) {
   // If channel count == 1, planar and non-planar formats are the same
@@ -610,19 +2829,30 @@ class cPaxcketQueue {
 public:
   //{{{
   int packet_queue_put_private (AVPacket* newPkt) {
-
+  // move newPkt into a recycled packet shell at the end of the ring, called with mutex locked
 
     if (abort_request)
       return -1;
 
     cPacketList pkt1;
-    pkt1.pkt = newPkt;
+    if (av_fifo_read (pktPool, &pkt1.pkt, 1) < 0) {
+      pkt1.pkt = av_packet_alloc();
+      if (!pkt1.pkt)
+        return AVERROR(ENOMEM);
+      packetAllocs++;
+      }
     pkt1.serial = serial;
 
+    int grow = !av_fifo_can_write (pktList);
     int ret = av_fifo_write (pktList, &pkt1, 1);
-    if (ret < 0)
+    if (ret < 0) {
+      av_log (NULL, AV_LOG_ERROR, "packet queue can't grow past %d packets\n", nb_packets);
+      packet_queue_recycle (pkt1.pkt);
       return ret;
+      }
+    ringGrows += grow;
 
+    av_packet_move_ref (pkt1.pkt, newPkt);
     nb_packets++;
     size += pkt1.pkt->size + sizeof(pkt1);
     duration += pkt1.pkt->duration;
@@ -633,9 +2863,17 @@ public:
     }
   //}}}
   //{{{
+  void packet_queue_recycle (AVPacket* oldPkt) {
+  // return an unreferenced packet shell to the pool, called with mutex locked
+
+    if (av_fifo_write (pktPool, &oldPkt, 1) < 0)
+      av_packet_free (&oldPkt);
+    }
+  //}}}
+  //{{{
   int packet_queue_put_nullpacket (AVPacket* newPkt, int stream_index) {
 
-    pkt->stream_index = stream_index;
+    newPkt->stream_index = stream_index;
     return packet_queue_put (newPkt);
     }
   //}}}
@@ -646,10 +2884,22 @@ public:
 
     memset (this, 0, sizeof(cPaxcketQueue));
 
-    pktList = av_fifo_alloc2 (1, sizeof(cPacketList), AV_FIFO_FLAG_AUTO_GROW);
+    pktList = av_fifo_alloc2 (PACKET_QUEUE_INIT_SIZE, sizeof(cPacketList), AV_FIFO_FLAG_AUTO_GROW);
     if (!pktList)
       return AVERROR(ENOMEM);
 
+    pktPool = av_fifo_alloc2 (PACKET_QUEUE_INIT_SIZE, sizeof(AVPacket*), AV_FIFO_FLAG_AUTO_GROW);
+    if (!pktPool)
+      return AVERROR(ENOMEM);
+    av_fifo_auto_grow_limit (pktPool, PACKET_POOL_MAX_SIZE);
+
+    for (int i = 0; i < PACKET_QUEUE_INIT_SIZE; i++) {
+      AVPacket* poolPkt = av_packet_alloc();
+      if (!poolPkt)
+        return AVERROR(ENOMEM);
+      av_fifo_write (pktPool, &poolPkt, 1);
+      }
+
     mutex = SDL_CreateMutex();
     if (!mutex) {
       av_log (NULL, AV_LOG_FATAL, "SDL_CreateMutex(): %s\n", SDL_GetError());
@@ -673,8 +2923,10 @@ public:
     cPacketList pkt1;
 
     SDL_LockMutex (mutex);
-    while (av_fifo_read (pktList, &pkt1, 1) >= 0)
-      av_packet_free (&pkt1.pkt);
+    while (av_fifo_read (pktList, &pkt1, 1) >= 0) {
+      av_packet_unref (pkt1.pkt);
+      packet_queue_recycle (pkt1.pkt);
+      }
 
     nb_packets = 0;
     size = 0;
@@ -690,6 +2942,16 @@ public:
     packet_queue_flush();
     av_fifo_freep2 (&pktList);
 
+    if (pktPool) {
+      AVPacket* poolPkt;
+      while (av_fifo_read (pktPool, &poolPkt, 1) >= 0)
+        av_packet_free (&poolPkt);
+      av_fifo_freep2 (&pktPool);
+      }
+
+    av_log (NULL, AV_LOG_VERBOSE, "packet queue allocated %d packets, grew ring %d times after startup\n",
+                                  packetAllocs, ringGrows);
+
     SDL_DestroyMutex (mutex);
     SDL_DestroyCond (cond);
     }
@@ -711,13 +2973,19 @@ public:
 
       cPacketList pkt1;
       if (av_fifo_read (pktList, &pkt1, 1) >= 0) {
+        int wasAboveLow = lowCond && !packet_queue_below (timeBase, gReadAheadLow, MIN_FRAMES / 2);
+        int wasAboveHalf = lowCond && (size >= gReadAheadKB * 512);
         nb_packets--;
         size -= pkt1.pkt->size + sizeof(pkt1);
         duration -= pkt1.pkt->duration;
+        if ((wasAboveLow && packet_queue_below (timeBase, gReadAheadLow, MIN_FRAMES / 2)) ||
+            (wasAboveHalf && (size < gReadAheadKB * 512)))
+          // this packet took the queue below a low watermark, wake the read thread
+          SDL_CondSignal (lowCond);
         av_packet_move_ref (newPkt, pkt1.pkt);
         if (newSerial)
             *newSerial = pkt1.serial;
-        av_packet_free (&pkt1.pkt);
+        packet_queue_recycle (pkt1.pkt);
         ret = 1;
         break;
         }
@@ -738,19 +3006,12 @@ public:
   //{{{
   int packet_queue_put (AVPacket* newPkt) {
 
-    AVPacket* pkt1 = av_packet_alloc();
-    if (!pkt1) {
-      av_packet_unref (newPkt);
-      return -1;
-      }
-    av_packet_move_ref (pkt1, newPkt);
-
     SDL_LockMutex (mutex);
-    int ret = packet_queue_put_private (pkt1);
+    int ret = packet_queue_put_private (newPkt);
     SDL_UnlockMutex (mutex);
 
     if (ret < 0)
-      av_packet_free (&pkt1);
+      av_packet_unref (newPkt);
 
     return ret;
     }
@@ -778,27 +3039,60 @@ public:
     }
   //}}}
 
+  //{{{
+  void packet_queue_budget (AVRational newTimeBase, SDL_cond* newLowCond) {
+  // packet_queue_get signals newLowCond as the queue drains below its low read-ahead watermark
+
+    SDL_LockMutex (mutex);
+    timeBase = av_q2d (newTimeBase);
+    lowCond = newLowCond;
+    SDL_UnlockMutex (mutex);
+    }
+  //}}}
+  //{{{
+  int packet_queue_below (double tb, double seconds, int frames) {
+  // true if the queue holds less than seconds of packets, packets without a duration count by frames
+
+    return (nb_packets <= frames) || (duration && (tb * duration) < seconds);
+    }
+  //}}}
   //{{{
   int streamHasEnoughPackets (AVStream* stream, int streamId) {
+  // at the high watermark
 
     return (streamId < 0) ||
            abort_request ||
            (stream->disposition & AV_DISPOSITION_ATTACHED_PIC) ||
-           nb_packets > MIN_FRAMES &&
-           (!duration || (av_q2d (stream->time_base) * duration) > 1.0);
+           !packet_queue_below (av_q2d (stream->time_base), gReadAheadHigh, MIN_FRAMES);
     }
   //}}}
+  //{{{
+  int streamNeedsPackets (AVStream* stream, int streamId) {
+  // below the low watermark
 
-  AVPacket* pkt;
-  AVFifo* pktList;
+    return (streamId >= 0) &&
+           !abort_request &&
+           !(stream->disposition & AV_DISPOSITION_ATTACHED_PIC) &&
+           packet_queue_below (av_q2d (stream->time_base), gReadAheadLow, MIN_FRAMES / 2);
+    }
+  //}}}
+
+  AVFifo* pktList;   // ring of queued cPacketList
+  AVFifo* pktPool;   // recycled empty AVPacket shells
 
   int nb_packets;
   int size;
   int64_t duration;
 
+  int packetAllocs;  // packet shells allocated after init, stays 0 in steady state
+  int ringGrows;     // times the ring grew past its preallocated size
+
   int abort_request;
   int serial;
 
+  double timeBase;    // of the stream, for the low watermark in packet_queue_get
+  SDL_cond* lowCond;  // the read thread's, NULL for no read-ahead signalling
+
   SDL_mutex* mutex;
   SDL_cond* cond;
   };
@@ -828,6 +3122,7 @@ public:
 
   AVRational sar;
   int uploaded;
+  int scaled;           // in scaledTexture at the display rect, when it is still scaledFrame
   int flip_v;
   };
 //}}}
@@ -839,20 +3134,25 @@ public:
 //}}}
 //{{{
 class cFrameQueue {
+// single producer, single consumer ring
+// - rindex, rindexShown are owned by the consumer, windex by the producer, size is shared
+// - no locks on the fast path, a side only blocks on its semaphore when the ring is full or empty
 public:
   //{{{
   int frame_queue_init (cPaxcketQueue* newPacketQueue, int newMaxSize, int newKeepLast) {
 
-    memset (this, 0, sizeof(cFrameQueue));
+    memset ((void*)this, 0, sizeof(cFrameQueue));
 
-    if (!(mutex = SDL_CreateMutex())) {
-      av_log (NULL, AV_LOG_FATAL, "SDL_CreateMutex(): %s\n", SDL_GetError());
+    if (!(readSem = SDL_CreateSemaphore (0))) {
+      //{{{  error return
+      av_log (NULL, AV_LOG_FATAL, "SDL_CreateSemaphore(): %s\n", SDL_GetError());
       return AVERROR(ENOMEM);
       }
+      //}}}
 
-    if (!(cond = SDL_CreateCond())) {
+    if (!(writeSem = SDL_CreateSemaphore (0))) {
       //{{{  error return
-      av_log (NULL, AV_LOG_FATAL, "SDL_CreateCond(): %s\n", SDL_GetError());
+      av_log (NULL, AV_LOG_FATAL, "SDL_CreateSemaphore(): %s\n", SDL_GetError());
       return AVERROR(ENOMEM);
       }
       //}}}
@@ -873,81 +3173,86 @@ public:
 
     for (int i = 0; i < maxSize; i++) {
       cFrame* frame = &queue[i];
-    frame->  frame_queue_unref_item();
+      frame->frame_queue_unref_item();
       av_frame_free (&frame->frame);
       }
 
-    SDL_DestroyMutex (mutex);
-    SDL_DestroyCond (cond);
+    SDL_DestroySemaphore (readSem);
+    SDL_DestroySemaphore (writeSem);
     }
   //}}}
   //{{{
   void frame_queue_signal() {
+  // wake both sides to recheck abort_request, a spare post only costs a spurious loop
 
-    SDL_LockMutex (mutex);
-    SDL_CondSignal (cond);
-    SDL_UnlockMutex (mutex);
+    SDL_SemPost (readSem);
+    SDL_SemPost (writeSem);
     }
   //}}}
 
   //{{{
   cFrame* frame_queue_peek() {
-    return &queue[(rindex + rindexShown) % maxSize];
+    return &queue[(SDL_AtomicGet (&rindex) + rindexShown) % maxSize];
     }
   //}}}
   //{{{
   cFrame* frame_queue_peek_next() {
-    return &queue[(rindex + rindexShown + 1) % maxSize];
+    return &queue[(SDL_AtomicGet (&rindex) + rindexShown + 1) % maxSize];
      }
   //}}}
   //{{{
+  cFrame* frame_queue_peek_offset (int offset) {
+    return &queue[(SDL_AtomicGet (&rindex) + rindexShown + offset) % maxSize];
+    }
+  //}}}
+  //{{{
   cFrame* frame_queue_peek_last() {
-    return &queue[rindex];
+    return &queue[SDL_AtomicGet (&rindex)];
     }
   //}}}
   //{{{
   cFrame* frame_queue_peek_writable() {
 
     /* wait until we have space to put a new frame */
-    SDL_LockMutex (mutex);
-
-    while (size >= maxSize && !packetQueue->abort_request) {
-      SDL_CondWait (cond, mutex);
+    while (SDL_AtomicGet (&size) >= maxSize && !packetQueue->abort_request) {
+      // publish waiting before the recheck, the consumer posts if it then sees us waiting
+      SDL_AtomicSet (&writerWaiting, 1);
+      if (SDL_AtomicGet (&size) >= maxSize && !packetQueue->abort_request)
+        SDL_SemWait (writeSem);
       }
-     SDL_UnlockMutex (mutex);
 
     if (packetQueue->abort_request)
       return NULL;
 
-    return &queue[windex];
+    return &queue[SDL_AtomicGet (&windex)];
     }
   //}}}
   //{{{
   cFrame* frame_queue_peek_readable() {
 
     /* wait until we have a readable a new frame */
-    SDL_LockMutex (mutex);
-    while (size - rindexShown <= 0 && !packetQueue->abort_request)
-      SDL_CondWait (cond, mutex);
-     SDL_UnlockMutex (mutex);
+    while (SDL_AtomicGet (&size) - rindexShown <= 0 && !packetQueue->abort_request) {
+      SDL_AtomicSet (&readerWaiting, 1);
+      if (SDL_AtomicGet (&size) - rindexShown <= 0 && !packetQueue->abort_request)
+        SDL_SemWait (readSem);
+      }
 
     if (packetQueue->abort_request)
       return NULL;
 
-    return &queue[(rindex + rindexShown) % maxSize];
+    return &queue[(SDL_AtomicGet (&rindex) + rindexShown) % maxSize];
     }
   //}}}
 
   //{{{
   void frame_queue_push() {
 
-    if (++windex == maxSize)
-      windex = 0;
+    int newWindex = SDL_AtomicGet (&windex) + 1;
+    SDL_AtomicSet (&windex, newWindex == maxSize ? 0 : newWindex);
 
-    SDL_LockMutex (mutex);
-    size++;
-    SDL_CondSignal (cond);
-    SDL_UnlockMutex (mutex);
+    SDL_AtomicAdd (&size, 1);
+    if (SDL_AtomicGet (&readerWaiting) && SDL_AtomicCAS (&readerWaiting, 1, 0))
+      SDL_SemPost (readSem);
     }
   //}}}
   //{{{
@@ -958,28 +3263,33 @@ public:
       return;
       }
 
-    queue[rindex].frame_queue_unref_item();
-    if (++rindex == maxSize)
-      rindex = 0;
+    int oldRindex = SDL_AtomicGet (&rindex);
+    queue[oldRindex].frame_queue_unref_item();
+    SDL_AtomicSet (&rindex, oldRindex + 1 == maxSize ? 0 : oldRindex + 1);
 
-    SDL_LockMutex (mutex);
-    size--;
-    SDL_CondSignal (cond);
-    SDL_UnlockMutex (mutex);
+    SDL_AtomicAdd (&size, -1);
+    if (SDL_AtomicGet (&writerWaiting) && SDL_AtomicCAS (&writerWaiting, 1, 0))
+      SDL_SemPost (writeSem);
     }
   //}}}
 
   //{{{
   /* return the number of undisplayed frames in the queue */
   int frame_queue_nb_remaining() {
-    return size - rindexShown;
+    return SDL_AtomicGet (&size) - rindexShown;
+    }
+  //}}}
+  //{{{
+  /* return the ring slot of a frame, for per slot resources */
+  int frame_queue_slot (cFrame* frame) {
+    return (int)(frame - queue);
     }
   //}}}
   //{{{
   /* return last shown position */
   int64_t frame_queue_last_pos() {
 
-    cFrame* frame = &queue[rindex];
+    cFrame* frame = &queue[SDL_AtomicGet (&rindex)];
     if (rindexShown && frame->serial == packetQueue->serial)
       return frame->pos;
     else
@@ -989,18 +3299,236 @@ public:
 
   cFrame queue[FRAME_QUEUE_SIZE];
 
-  int rindex;
-  int windex;
-
-  int size;
   int maxSize;
   int keepLast;
+  cPaxcketQueue* packetQueue;
+
+  // consumer side
+  alignas(CACHE_LINE_SIZE) SDL_atomic_t rindex;
   int rindexShown;
+  SDL_atomic_t readerWaiting;
+  SDL_sem* readSem;
 
-  SDL_mutex* mutex;
-  SDL_cond* cond;
+  // producer side
+  alignas(CACHE_LINE_SIZE) SDL_atomic_t windex;
+  SDL_atomic_t writerWaiting;
+  SDL_sem* writeSem;
+
+  alignas(CACHE_LINE_SIZE) SDL_atomic_t size;
+  };
+//}}}
+//{{{
+class cAudioRing {
+// single producer, single consumer ring of output pcm, audioThread converts into it, sdlAudioCallback plays it
+// - read and write are free running byte counts, the ring is a power of two bytes so they wrap with a mask
+// - each write is a chunk carrying the pts at its end, its serial and pos, the callback's clock comes from them
+// - the consumer never blocks, locks or allocates, only the producer waits on its semaphore for space
+public:
+  //{{{
+  struct sChunk {
+    unsigned end;  // write count at the end of the chunk
+    double clock;  // pts at the end of the chunk, NAN if unknown
+    double tempo;  // media seconds per played second, the audio stretch it was made at
+    int serial;
+    int64_t pos;
+    };
+  //}}}
+
+  //{{{
+  int init (int minSize, cPaxcketQueue* newPacketQueue) {
+
+    memset ((void*)this, 0, sizeof(cAudioRing));
+    last.tempo = 1.0;
+
+    if (!(writeSem = SDL_CreateSemaphore (0))) {
+      //{{{  error return
+      av_log (NULL, AV_LOG_FATAL, "SDL_CreateSemaphore(): %s\n", SDL_GetError());
+      return AVERROR(ENOMEM);
+      }
+      //}}}
+
+    size = 1 << av_ceil_log2 (minSize);
+    if (!(buffer = (uint8_t*)av_malloc (size)))
+      return AVERROR(ENOMEM);
+
+    packetQueue = newPacketQueue;
+    last.clock = NAN;
+    last.serial = -1;
+    last.pos = -1;
+    return 0;
+    }
+  //}}}
+  //{{{
+  void destroy() {
+
+    av_freep (&buffer);
+    if (writeSem)
+      SDL_DestroySemaphore (writeSem);
+    writeSem = NULL;
+    }
+  //}}}
+  //{{{
+  void signal() {
+  // wake the producer to recheck abort_request
+    SDL_SemPost (writeSem);
+    }
+  //}}}
+
+  //{{{
+  int write (const uint8_t* data, int len, double clock, double tempo, int serial, int64_t pos, int bytesPerSec) {
+  // producer, copy len bytes in as one or more chunks, waiting for space, < 0 on abort
+
+    while (len > 0) {
+      // no chunk needs more than half the ring, a bigger frame is split and its clock stepped back per part
+      int part = FFMIN(len, size / 2);
+      len -= part;
+
+      while (!hasSpace (part) && !packetQueue->abort_request) {
+        // publish waiting before the recheck, the consumer posts if it then sees us waiting
+        SDL_AtomicSet (&writerWaiting, 1);
+        if (!hasSpace (part) && !packetQueue->abort_request)
+          SDL_SemWait (writeSem);
+        }
+      if (packetQueue->abort_request)
+        return -1;
+
+      unsigned writeCount = (unsigned)SDL_AtomicGet (&writeBytes);
+      int offset = (int)(writeCount & (size - 1));
+      int first = FFMIN(part, size - offset);
+      memcpy (buffer + offset, data, first);
+      memcpy (buffer, data + first, part - first);
+      data += part;
+
+      unsigned chunkIndex = (unsigned)SDL_AtomicGet (&writeChunks);
+      sChunk* chunk = &chunks[chunkIndex & (AUDIO_RING_CHUNKS - 1)];
+      chunk->end = writeCount + part;
+      chunk->clock = isnan (clock) ? NAN : clock - (double)len / bytesPerSec * tempo;
+      chunk->tempo = tempo;
+      chunk->serial = serial;
+      chunk->pos = pos;
+
+      // bytes before the chunk that covers them
+      SDL_AtomicSet (&writeBytes, (int)(writeCount + part));
+      SDL_AtomicSet (&writeChunks, (int)(chunkIndex + 1));
+      }
+
+    return 0;
+    }
+  //}}}
+
+  //{{{
+  const sChunk* chunk() {
+  // consumer, the chunk at the read position, NULL when the ring is empty
+
+    unsigned chunkIndex = (unsigned)SDL_AtomicGet (&readChunks);
+    if (chunkIndex == (unsigned)SDL_AtomicGet (&writeChunks))
+      return NULL;
+    return &chunks[chunkIndex & (AUDIO_RING_CHUNKS - 1)];
+    }
+  //}}}
+  //{{{
+  const uint8_t* readable (const sChunk* readChunk, int* len) {
+  // consumer, the contiguous bytes left of readChunk
+
+    unsigned readCount = (unsigned)SDL_AtomicGet (&readBytes);
+    int offset = (int)(readCount & (size - 1));
+    *len = FFMIN((int)(readChunk->end - readCount), size - offset);
+    return buffer + offset;
+    }
+  //}}}
+  //{{{
+  void consume (const sChunk* readChunk, int len) {
+  // consumer, release len bytes of readChunk to the producer
+
+    unsigned readCount = (unsigned)SDL_AtomicGet (&readBytes) + len;
+    if (readCount == readChunk->end) {
+      last = *readChunk;
+      // for lastPos on the main thread, a sequence count around atomics so it never reads a half published pos
+      SDL_AtomicIncRef (&lastSequence);
+      SDL_AtomicSet (&lastSerial, readChunk->serial);
+      SDL_AtomicSet (&lastPosLow, (int)(uint32_t)readChunk->pos);
+      SDL_AtomicSet (&lastPosHigh, (int)(readChunk->pos >> 32));
+      SDL_AtomicIncRef (&lastSequence);
+      }
+    SDL_AtomicSet (&readBytes, (int)readCount);
+    if (readCount == readChunk->end)
+      SDL_AtomicAdd (&readChunks, 1);
+
+    if (SDL_AtomicGet (&writerWaiting) && SDL_AtomicCAS (&writerWaiting, 1, 0))
+      SDL_SemPost (writeSem);
+    }
+  //}}}
+  //{{{
+  void skip (const sChunk* readChunk) {
+  // consumer, drop the rest of readChunk
+    consume (readChunk, (int)(readChunk->end - (unsigned)SDL_AtomicGet (&readBytes)));
+    }
+  //}}}
+  //{{{
+  const sChunk* playing (int* remaining) {
+  // consumer, the chunk being played and its bytes not yet played, the last one finished when empty
+
+    const sChunk* readChunk = chunk();
+    if (!readChunk) {
+      *remaining = 0;
+      return &last;
+      }
+
+    *remaining = (int)(readChunk->end - (unsigned)SDL_AtomicGet (&readBytes));
+    return readChunk;
+    }
+  //}}}
+
+  //{{{
+  int empty() {
+    return SDL_AtomicGet (&readChunks) == SDL_AtomicGet (&writeChunks);
+    }
+  //}}}
+  //{{{
+  int64_t lastPos() {
+  // main thread, the pos of the last played chunk, retried while the callback is publishing a new one
+
+    for (;;) {
+      int sequence = SDL_AtomicGet (&lastSequence);
+      if (sequence & 1)
+        continue;
+
+      int serial = SDL_AtomicGet (&lastSerial);
+      int64_t pos = ((int64_t)SDL_AtomicGet (&lastPosHigh) << 32) | (uint32_t)SDL_AtomicGet (&lastPosLow);
+      if (SDL_AtomicGet (&lastSequence) == sequence)
+        return (serial == packetQueue->serial) ? pos : -1;
+      }
+    }
+  //}}}
+
+private:
+  //{{{
+  int hasSpace (int len) {
+
+    return ((int)((unsigned)SDL_AtomicGet (&writeBytes) - (unsigned)SDL_AtomicGet (&readBytes)) + len <= size) &&
+           ((int)((unsigned)SDL_AtomicGet (&writeChunks) - (unsigned)SDL_AtomicGet (&readChunks)) < AUDIO_RING_CHUNKS);
+    }
+  //}}}
 
+  uint8_t* buffer;
+  int size;
   cPaxcketQueue* packetQueue;
+  sChunk chunks[AUDIO_RING_CHUNKS];
+
+  // consumer side
+  alignas(CACHE_LINE_SIZE) SDL_atomic_t readBytes;
+  SDL_atomic_t readChunks;
+  sChunk last;
+  SDL_atomic_t lastSequence;  // odd while consume publishes last's serial and pos
+  SDL_atomic_t lastSerial;
+  SDL_atomic_t lastPosLow;
+  SDL_atomic_t lastPosHigh;
+
+  // producer side
+  alignas(CACHE_LINE_SIZE) SDL_atomic_t writeBytes;
+  SDL_atomic_t writeChunks;
+  SDL_atomic_t writerWaiting;
+  SDL_sem* writeSem;
   };
 //}}}
 //{{{
@@ -1014,11 +3542,19 @@ public:
     pkt = av_packet_alloc();
     if (!pkt)
       return AVERROR(ENOMEM);
+    frameDataPool = av_buffer_pool_init (sizeof(cFrameData), av_buffer_allocz);
+    if (!frameDataPool)
+      return AVERROR(ENOMEM);
     avctx = newAvctx;
     queue = newQueue;
     empty_queue_cond = newEmpty_queue_cond;
+    queue->packet_queue_budget (avctx->pkt_timebase, empty_queue_cond);
     start_pts = AV_NOPTS_VALUE;
     pkt_serial = -1;
+    skipFrame = avctx->skip_frame;
+    skipLoopFilter = avctx->skip_loop_filter;
+    SDL_AtomicSet (&trickSkip, AVDISCARD_DEFAULT);
+    SDL_AtomicSet (&prerollSerial, -1);
 
     return 0;
     }
@@ -1042,6 +3578,7 @@ public:
   //{{{
   int decodeFrame (AVFrame* frame, AVSubtitle* sub) {
 
+    cTraceSpan span (av_get_media_type_string (avctx->codec_type), "decodeFrame");
     int ret = AVERROR(EAGAIN);
 
     for (;;) {
@@ -1099,8 +3636,10 @@ public:
           packet_pending = 0;
         else {
           int old_serial = pkt_serial;
+          cTraceSpan waitSpan (av_get_media_type_string (avctx->codec_type), "packet_queue_get");
           if (queue->packet_queue_get (pkt, 1, &pkt_serial) < 0)
             return -1;
+          waitSpan.end();
           if (old_serial != pkt_serial) {
             avcodec_flush_buffers (avctx);
             finished = 0;
@@ -1132,13 +3671,21 @@ public:
         //{{{  audio, video
         if (pkt->buf && !pkt->opaque_ref) {
           cFrameData* frameData;
-          pkt->opaque_ref = av_buffer_allocz (sizeof(*frameData));
+          pkt->opaque_ref = av_buffer_pool_get (frameDataPool);
           if (!pkt->opaque_ref)
             return AVERROR(ENOMEM);
           frameData = (cFrameData*)pkt->opaque_ref->data;
           frameData->pkt_pos = pkt->pos;
           }
 
+        if (avctx->codec_type == AVMEDIA_TYPE_VIDEO) {
+          // a frame before an accurate seek target is never shown, unreferenced it needn't be decoded at all
+          bool preroll = isPreroll (pkt->pts, avctx->pkt_timebase);
+          enum AVDiscard skip = FFMAX(skipFrame, (enum AVDiscard)SDL_AtomicGet (&trickSkip));
+          avctx->skip_frame = preroll ? FFMAX(skip, AVDISCARD_NONREF) : skip;
+          avctx->skip_loop_filter = preroll ? FFMAX(skipLoopFilter, AVDISCARD_NONREF) : skipLoopFilter;
+          }
+
         if (avcodec_send_packet (avctx, pkt) == AVERROR(EAGAIN)) {
           av_log (avctx, AV_LOG_ERROR, "Receive_frame and send_packet both returned EAGAIN, which is an API violation.\n");
           packet_pending = 1;
@@ -1150,11 +3697,51 @@ public:
       }
     }
   //}}}
+  void setTrickSkip (enum AVDiscard skip) { SDL_AtomicSet (&trickSkip, skip); }
+  //{{{
+  void setPreroll (int64_t target, int serial) {
+  // decode from the keyframe before target, frames of serial ending before it are dropped unshown
+  // - called by the read thread after the flush that made serial, before any packet of it is queued
+
+    prerollTarget = target;
+    prerollFrames = 0;
+    prerollStart = av_gettime_relative();
+    SDL_AtomicSet (&prerollSerial, serial);
+    }
+  //}}}
+  //{{{
+  bool isPreroll (int64_t pts, AVRational tb) {
+
+    return (pts != AV_NOPTS_VALUE) && (SDL_AtomicGet (&prerollSerial) == pkt_serial) &&
+           (av_compare_ts (pts, tb, prerollTarget, { 1, AV_TIME_BASE }) < 0);
+    }
+  //}}}
+  //{{{
+  bool dropPreroll (AVFrame* frame, int64_t lastPts, AVRational tb) {
+  // true for a decoded frame ending before the target, the first one reaching it ends the preroll
+
+    if (SDL_AtomicGet (&prerollSerial) != pkt_serial)
+      return false;
+
+    if (isPreroll (lastPts, tb)) {
+      prerollFrames++;
+      av_frame_unref (frame);
+      return true;
+      }
+
+    // a timestamp wrap later in this serial must not drop anything, a newer seek may have replaced the serial already
+    if (SDL_AtomicCAS (&prerollSerial, pkt_serial, -1))
+      av_log (NULL, AV_LOG_VERBOSE, "%s accurate seek, %d frames decoded ahead of the target in %.1fms\n",
+              av_get_media_type_string (avctx->codec_type), prerollFrames, (av_gettime_relative() - prerollStart) / 1000.0);
+    return false;
+    }
+  //}}}
   //{{{
   void decoderAbort (cFrameQueue* frameQueue) {
 
     queue->packet_queue_abort();
-    frameQueue->frame_queue_signal();
+    if (frameQueue)
+      frameQueue->frame_queue_signal();
     SDL_WaitThread (decoder_tid, NULL);
 
     decoder_tid = NULL;
@@ -1165,11 +3752,13 @@ public:
   void decoderDestroy() {
 
     av_packet_free (&pkt);
+    av_buffer_pool_uninit (&frameDataPool);
     avcodec_free_context (&avctx);
     }
   //}}}
 
   AVPacket* pkt;
+  AVBufferPool* frameDataPool;  // recycled cFrameData opaque_refs
   cPaxcketQueue* queue;
   AVCodecContext* avctx;
 
@@ -1185,6 +3774,14 @@ public:
   int64_t next_pts;
   AVRational next_pts_tb;
 
+  enum AVDiscard skipFrame;       // as opened, the preroll raises them for a packet
+  enum AVDiscard skipLoopFilter;
+  SDL_atomic_t trickSkip;         // raised with the trick play speed
+  SDL_atomic_t prerollSerial;     // -1 none
+  int64_t prerollTarget;          // AV_TIME_BASE
+  int64_t prerollStart;
+  int prerollFrames;
+
   SDL_Thread* decoder_tid;
   };
 //}}}
@@ -1215,8 +3812,6 @@ public:
      goto fail;
    if (videoState->subpq.frame_queue_init (&videoState->subtitleq, SUBPICTURE_QUEUE_SIZE, 0) < 0)
      goto fail;
-   if (videoState->sampq.frame_queue_init (&videoState->audioq, SAMPLE_QUEUE_SIZE, 1) < 0)
-     goto fail;
 
    if (videoState->videoq.packet_queue_init() < 0 ||
        videoState->audioq.packet_queue_init() < 0 ||
@@ -1233,6 +3828,12 @@ public:
    videoState->vidclk.init_clock (&videoState->videoq.serial);
    videoState->audclk.init_clock (&videoState->audioq.serial);
    videoState->extclk.init_clock (&videoState->extclk.serial);
+   videoState->speed = 1.0;
+   SDL_AtomicSet (&videoState->audio_device_latency, -1);
+   videoState->audioTempo = 1.0;
+   SDL_AtomicSet (&videoState->stretchTempo, 1000);
+   videoState->stretchSpeedMin = SPEED_MIN;
+   videoState->stretchSpeedMax = AUDIO_STRETCH_MAX;
    videoState->audio_clock_serial = -1;
    if (gStartupVolume < 0)
      av_log (NULL, AV_LOG_WARNING, "-volume=%d < 0, setting to 0\n", gStartupVolume);
@@ -1269,7 +3870,8 @@ public:
       }
 
     else if (av_sync_type == AV_SYNC_AUDIO_MASTER) {
-      if (audioStream)
+      // trick play mutes the audio, its clock stands still
+      if (audioStream && !SDL_AtomicGet (&trickAudioMuted))
         return AV_SYNC_AUDIO_MASTER;
       else
         return AV_SYNC_EXTERNAL_CLOCK;
@@ -1329,7 +3931,7 @@ public:
     /* update delay to follow master synchronisation source */
     if (get_master_sync_type() != AV_SYNC_VIDEO_MASTER) {
       /* if video is slave, we try to correct big delays by duplicating or deleting a frame */
-      diff = vidclk.get_clock() - get_master_clock();
+      diff = (vidclk.get_clock() - get_master_clock()) / speed;
 
       /* skip or repeat frame. We take into account the
          delay to compute the threshold. I still don't know if it is the best guess */
@@ -1389,11 +3991,18 @@ public:
     AVRational fr = av_guess_frame_rate (formatContext, videoStream, NULL);
 
     int nb_pix_fmts = 0;
-    for (int i = 0; i < (int)gRendererInfo.num_texture_formats; i++) {
-      for (int j = 0; j < FF_ARRAY_ELEMS(sdlTextureFormatMap) - 1; j++) {
-        if (gRendererInfo.texture_formats[i] == (uint32_t)sdlTextureFormatMap[j].texture_fmt) {
-          pix_fmts[nb_pix_fmts++] = sdlTextureFormatMap[j].format;
-          break;
+    if (gRendererInfo.flags & SDL_RENDERER_SOFTWARE) {
+      // the software renderer lists only rgb, yet yuv is better passed through, scaled it goes to rgb in
+      // uploadScaledPicture's one sws pass, unscaled SDL converts the yuv texture itself
+      for (int j = 0; j < FF_ARRAY_ELEMS(sdlTextureFormatMap) - 1; j++)
+        pix_fmts[nb_pix_fmts++] = sdlTextureFormatMap[j].format;
+      }
+    else {
+      for (int i = 0; i < (int)gRendererInfo.num_texture_formats; i++) {
+        for (int j = 0; j < FF_ARRAY_ELEMS(sdlTextureFormatMap) - 1; j++) {
+          // offer every format that uploads to this texture format, including the downconverted ones
+          if (gRendererInfo.texture_formats[i] == (uint32_t)sdlTextureFormatMap[j].texture_fmt)
+            pix_fmts[nb_pix_fmts++] = sdlTextureFormatMap[j].format;
           }
         }
       }
@@ -1500,7 +4109,10 @@ public:
   //{{{
   int configureAudioFilters (const char* filters, int force_output_format) {
 
-    static const enum AVSampleFormat sample_fmts[] = { AV_SAMPLE_FMT_S16, AV_SAMPLE_FMT_NONE };
+    // the sink hands audioDecodeFrame the device format once it is open, swr then only resamples
+    enum AVSampleFormat sample_fmts[] = { gAudioFloat ? AV_SAMPLE_FMT_FLT : AV_SAMPLE_FMT_S16, AV_SAMPLE_FMT_NONE };
+    if (force_output_format)
+      sample_fmts[0] = audio_tgt.fmt;
     int sample_rates[2] = { 0, -1 };
 
     AVFilterContext* filt_asrc = NULL;
@@ -1509,6 +4121,7 @@ public:
     char aresample_swr_opts[512] = "";
     const AVDictionaryEntry* entry = NULL;
     AVBPrint bp;
+    AVBPrint tempoFilters;
     char asrc_args[256];
     int ret;
 
@@ -1519,6 +4132,18 @@ public:
 
     av_bprint_init (&bp, 0, AV_BPRINT_SIZE_AUTOMATIC);
 
+    // audioTempo stretches after the user filters, atempo takes 0.5 at least so slower tempos chain it
+    av_bprint_init (&tempoFilters, 0, AV_BPRINT_SIZE_AUTOMATIC);
+    if (audioTempo != 1.0) {
+      if (filters)
+        av_bprintf (&tempoFilters, "%s,", filters);
+      double tempo = audioTempo;
+      for (; tempo < 0.5; tempo /= 0.5)
+        av_bprintf (&tempoFilters, "atempo=0.5,");
+      av_bprintf (&tempoFilters, "atempo=%g", tempo);
+      filters = tempoFilters.str;
+      }
+
     while ((entry = av_dict_iterate(swr_opts, entry)))
       av_strlcatf (aresample_swr_opts, sizeof(aresample_swr_opts), "%s=%s:", entry->key, entry->value);
     if (strlen (aresample_swr_opts))
@@ -1567,6 +4192,7 @@ public:
     if (ret < 0)
       avfilter_graph_free (&agraph);
     av_bprint_finalize (&bp, NULL);
+    av_bprint_finalize (&tempoFilters, NULL);
 
     return ret;
     }
@@ -1586,6 +4212,19 @@ public:
 
       frame->sample_aspect_ratio = av_guess_sample_aspect_ratio (formatContext, videoStream, frame);
 
+      // accurate seek, frames ending before the target go before the filter graph, the one showing it stays
+      int64_t lastPts = frame->pts;
+      if (lastPts != AV_NOPTS_VALUE) {
+        int64_t duration = frame->duration;
+        if (duration <= 0) {
+          AVRational frameRate = av_guess_frame_rate (formatContext, videoStream, frame);
+          duration = (frameRate.num && frameRate.den) ? av_rescale_q (1, av_inv_q (frameRate), videoStream->time_base) : 1;
+          }
+        lastPts += FFMAX(duration, 1) - 1;
+        }
+      if (viddec.dropPreroll (frame, lastPts, videoStream->time_base))
+        return 0;
+
       if (framedrop >0  || (framedrop && get_master_sync_type() != AV_SYNC_VIDEO_MASTER)) {
         if (frame->pts != AV_NOPTS_VALUE) {
           double diff = dpts - get_master_clock();
@@ -1594,6 +4233,7 @@ public:
               viddec.pkt_serial == vidclk.getSerial() &&
               videoq.nb_packets) {
             frame_drops_early++;
+            addTelemetryFrame (TELEMETRY_DROP_EARLY, dpts, 0.0, 0.0);
             av_frame_unref (frame);
             got_picture = 0;
             }
@@ -1625,19 +4265,28 @@ public:
   //}}}
 
   //{{{
-  void update_sample_display (short* samples, int samples_size) {
-  /* copy samples for viewing in editor window */
+  void update_sample_display (const uint8_t* samples, int samples_size) {
+  /* copy samples for viewing in editor window, the display works in s16 whatever the device format */
 
     int size, len;
 
-    size = samples_size / sizeof(short);
+    int floatSamples = audio_tgt.fmt == AV_SAMPLE_FMT_FLT;
+    size = samples_size / av_get_bytes_per_sample (audio_tgt.fmt);
     while (size > 0) {
       len = SAMPLE_ARRAY_SIZE - sample_array_index;
       if (len > size)
         len = size;
 
-      memcpy (sample_array + sample_array_index, samples, len * sizeof(short));
-      samples += len;
+      if (floatSamples) {
+        const float* src = (const float*)samples;
+        for (int i = 0; i < len; i++)
+          sample_array[sample_array_index + i] = (int16_t)av_clip_int16 (lrintf (src[i] * 32767.0f));
+        samples += len * sizeof(float);
+        }
+      else {
+        memcpy (sample_array + sample_array_index, samples, len * sizeof(short));
+        samples += len * sizeof(short);
+        }
       sample_array_index += len;
       if (sample_array_index >= SAMPLE_ARRAY_SIZE)
         sample_array_index = 0;
@@ -1669,7 +4318,8 @@ public:
           avg_diff = audio_diff_cum * (1.0 - audio_diff_avg_coef);
 
           if (fabs(avg_diff) >= audio_diff_threshold) {
-            wanted_nb_samples = nb_samples + (int)(diff * audio_src.freq);
+            // diff is media time, a stretched sample plays audioTempo of it
+            wanted_nb_samples = nb_samples + (int)(diff / audioTempo * audio_src.freq);
             min_nb_samples = ((nb_samples * (100 - SAMPLE_CORRECTION_PERCENT_MAX) / 100));
             max_nb_samples = ((nb_samples * (100 + SAMPLE_CORRECTION_PERCENT_MAX) / 100));
             wanted_nb_samples = av_clip(wanted_nb_samples, min_nb_samples, max_nb_samples);
@@ -1691,66 +4341,49 @@ public:
     }
   //}}}
   //{{{
-  int audioDecodeFrame() {
-  // Decode one audio frame and return its uncompressed size.
-  // The processed audio frame is decoded, converted if required, and
-  // stored in videoState->audio_buf, with size in bytes given by the return value.
+  int audioConvertFrame (AVFrame* frame, double pts, int serial, int64_t pos) {
+  // convert a filtered frame to the device format on the audio thread and queue it for the callback
+  // - blocks while the ring is full, < 0 on abort or error
 
     int resampled_data_size = 0;
+    const uint8_t* audio_buf;
 
-    if (paused)
-      return -1;
+    int data_size = av_samples_get_buffer_size (NULL, frame->ch_layout.nb_channels,
+                                                frame->nb_samples,
+                                                (AVSampleFormat)(frame->format), 1);
 
-    cFrame* audioFrame;
-    do {
-      #if defined(_WIN32)
-        while (sampq.frame_queue_nb_remaining() == 0) {
-          if ((av_gettime_relative() - gAudioCallbackTime) >
-               1000000LL * audio_hw_buf_size / audio_tgt.bytes_per_sec / 2)
-            return -1;
-          av_usleep (1000);
-          }
-      #endif
-        if (!(audioFrame = sampq.frame_queue_peek_readable()))
-          return -1;
-        sampq.frame_queue_next();
-      } while (audioFrame->serial != audioq.serial);
-    int data_size = av_samples_get_buffer_size (NULL, audioFrame->frame->ch_layout.nb_channels,
-                                                audioFrame->frame->nb_samples,
-                                                (AVSampleFormat)(audioFrame->frame->format), 1);
-
-    int wanted_nb_samples = synchronizeAudio (audioFrame->frame->nb_samples);
-
-    if (audioFrame->frame->format != audio_src.fmt ||
-        av_channel_layout_compare (&audioFrame->frame->ch_layout, &audio_src.channelLayout) ||
-        audioFrame->frame->sample_rate != audio_src.freq ||
-        (wanted_nb_samples != audioFrame->frame->nb_samples && !swrContext)) {
+    int wanted_nb_samples = synchronizeAudio (frame->nb_samples);
+
+    if (frame->format != audio_src.fmt ||
+        av_channel_layout_compare (&frame->ch_layout, &audio_src.channelLayout) ||
+        frame->sample_rate != audio_src.freq ||
+        (wanted_nb_samples != frame->nb_samples && !swrContext)) {
       swr_free (&swrContext);
       swr_alloc_set_opts2 (&swrContext,
                            &audio_tgt.channelLayout, audio_tgt.fmt, audio_tgt.freq,
-                           &audioFrame->frame->ch_layout, (AVSampleFormat)(audioFrame->frame->format), audioFrame->frame->sample_rate,
+                           &frame->ch_layout, (AVSampleFormat)(frame->format), frame->sample_rate,
                            0, NULL);
       if (!swrContext || swr_init (swrContext) < 0) {
         av_log (NULL, AV_LOG_ERROR,
                 "Cannot create sample rate converter for conversion of %d Hz %s %d channels to %d Hz %s %d channels!\n",
-                audioFrame->frame->sample_rate, av_get_sample_fmt_name ((AVSampleFormat)(audioFrame->frame->format)),
-                audioFrame->frame->ch_layout.nb_channels,
+                frame->sample_rate, av_get_sample_fmt_name ((AVSampleFormat)(frame->format)),
+                frame->ch_layout.nb_channels,
                 audio_tgt.freq, av_get_sample_fmt_name (audio_tgt.fmt),
                 audio_tgt.channelLayout.nb_channels);
           swr_free (&swrContext);
         return -1;
         }
 
-      if (av_channel_layout_copy (&audio_src.channelLayout, &audioFrame->frame->ch_layout) < 0)
+      if (av_channel_layout_copy (&audio_src.channelLayout, &frame->ch_layout) < 0)
         return -1;
-      audio_src.freq = audioFrame->frame->sample_rate;
-      audio_src.fmt = (AVSampleFormat)audioFrame->frame->format;
+      audio_src.freq = frame->sample_rate;
+      audio_src.fmt = (AVSampleFormat)frame->format;
       }
 
     if (swrContext) {
-      const uint8_t** in = (const uint8_t**)audioFrame->frame->extended_data;
+      const uint8_t** in = (const uint8_t**)frame->extended_data;
       uint8_t** out = &audio_buf1;
-      int out_count = (int64_t)wanted_nb_samples * audio_tgt.freq / audioFrame->frame->sample_rate + 256;
+      int out_count = (int64_t)wanted_nb_samples * audio_tgt.freq / frame->sample_rate + 256;
       int out_size  = av_samples_get_buffer_size (NULL, audio_tgt.channelLayout.nb_channels, out_count, audio_tgt.fmt, 0);
       int len2;
       if (out_size < 0) {
@@ -1758,9 +4391,9 @@ public:
         return -1;
         }
 
-      if (wanted_nb_samples != audioFrame->frame->nb_samples) {
-        if (swr_set_compensation (swrContext, (wanted_nb_samples - audioFrame->frame->nb_samples) * audio_tgt.freq / audioFrame->frame->sample_rate,
-                                  wanted_nb_samples * audio_tgt.freq / audioFrame->frame->sample_rate) < 0) {
+      if (wanted_nb_samples != frame->nb_samples) {
+        if (swr_set_compensation (swrContext, (wanted_nb_samples - frame->nb_samples) * audio_tgt.freq / frame->sample_rate,
+                                  wanted_nb_samples * audio_tgt.freq / frame->sample_rate) < 0) {
            av_log (NULL, AV_LOG_ERROR, "swr_set_compensation() failed\n");
            return -1;
            }
@@ -1770,7 +4403,7 @@ public:
       if (!audio_buf1)
         return AVERROR(ENOMEM);
 
-      len2 = swr_convert (swrContext, out, out_count, in, audioFrame->frame->nb_samples);
+      len2 = swr_convert (swrContext, out, out_count, in, frame->nb_samples);
       if (len2 < 0) {
         av_log (NULL, AV_LOG_ERROR, "swr_convert() failed\n");
         return -1;
@@ -1785,31 +4418,13 @@ public:
       resampled_data_size = len2 * audio_tgt.channelLayout.nb_channels * av_get_bytes_per_sample(audio_tgt.fmt);
       }
     else {
-      audio_buf = audioFrame->frame->data[0];
+      audio_buf = frame->data[0];
       resampled_data_size = data_size;
       }
 
-    // update the audio clock with the pts
-    #ifdef DEBUG
-      av_unused double audio_clock0 = audio_clock;
-    #endif
-
-    if (!isnan (audioFrame->pts))
-      audio_clock = audioFrame->pts + (double) audioFrame->frame->nb_samples / audioFrame->frame->sample_rate;
-    else
-      audio_clock = NAN;
-    audio_clock_serial = audioFrame->serial;
-
-    #ifdef DEBUG
-      {
-      static double last_clock;
-      printf ("audio: delay:%0.3f clock:%0.3f clock0:%0.3f\n",
-              audio_clock - last_clock, audio_clock, audio_clock0);
-      last_clock = audio_clock;
-      }
-    #endif
-
-    return resampled_data_size;
+    // a stretched frame covers audioTempo times its duration of the media
+    double clock = isnan (pts) ? NAN : pts + (double)frame->nb_samples / frame->sample_rate * audioTempo;
+    return audioRing.write (audio_buf, resampled_data_size, clock, audioTempo, serial, pos, audio_tgt.bytes_per_sec);
     }
   //}}}
   //{{{
@@ -1819,6 +4434,9 @@ public:
     SDL_AudioSpec audioSpec;
     SDL_AudioSpec wantedAudioSpec;
 
+    if (gAudioTraceBuffer < 0)
+      gAudioTraceBuffer = gTrace.reserveThreadBuffer ("sdl audio callback");
+
     static const int next_nb_channels[] = {0, 0, 1, 6, 2, 6, 4, 6};
     static const int next_sample_rates[] = {0, 44100, 48000, 96000, 192000};
     int next_sample_rate_idx = FF_ARRAY_ELEMS(next_sample_rates) - 1;
@@ -1849,14 +4467,23 @@ public:
     while (next_sample_rate_idx && next_sample_rates[next_sample_rate_idx] >= wantedAudioSpec.freq)
       next_sample_rate_idx--;
 
-    wantedAudioSpec.format = AUDIO_S16SYS;
+    // f32 saves decoders that output float a conversion and keeps their headroom
+    wantedAudioSpec.format = gAudioFloat ? AUDIO_F32SYS : AUDIO_S16SYS;
     wantedAudioSpec.silence = 0;
     wantedAudioSpec.samples = FFMAX(SDL_AUDIO_MIN_BUFFER_SIZE, 2 << av_log2(wantedAudioSpec.freq / SDL_AUDIO_MAX_CALLBACKS_PER_SEC));
+    audio_max_samples = wantedAudioSpec.samples;
+    if (gLowLatency)
+      wantedAudioSpec.samples = FFMAX(SDL_AUDIO_LOWLATENCY_MIN_SAMPLES,
+                                      2 << av_log2(wantedAudioSpec.freq / SDL_AUDIO_LOWLATENCY_CALLBACKS_PER_SEC));
     wantedAudioSpec.callback = sdlAudioCallback;
     wantedAudioSpec.userdata = this;
 
-    while (!(gAudioDevice = SDL_OpenAudioDevice (NULL, 0, &wantedAudioSpec, &audioSpec,
-                                                 SDL_AUDIO_ALLOW_FREQUENCY_CHANGE | SDL_AUDIO_ALLOW_CHANNELS_CHANGE))) {
+    // take the device's own format when it is one the volume path handles, else SDL converts to ours,
+    // -noaudio_float holds s16 whatever the device prefers
+    int allowedChanges = SDL_AUDIO_ALLOW_FREQUENCY_CHANGE | SDL_AUDIO_ALLOW_CHANNELS_CHANGE;
+    if (gAudioFloat)
+      allowedChanges |= SDL_AUDIO_ALLOW_FORMAT_CHANGE;
+    while (!(gAudioDevice = SDL_OpenAudioDevice (NULL, 0, &wantedAudioSpec, &audioSpec, allowedChanges))) {
       av_log (NULL, AV_LOG_WARNING, "SDL_OpenAudio (%d channels, %d Hz): %s\n",
                                     wantedAudioSpec.channels, wantedAudioSpec.freq, SDL_GetError());
       wantedAudioSpec.channels = (uint8_t)next_nb_channels[FFMIN(7, wantedAudioSpec.channels)];
@@ -1873,12 +4500,21 @@ public:
       av_channel_layout_default (wantedChannelLayout, wantedAudioSpec.channels);
       }
 
-    if (audioSpec.format != AUDIO_S16SYS) {
-      //{{{  error return
-      av_log (NULL, AV_LOG_ERROR, "SDL advised audio format %d is not supported!\n", audioSpec.format);
-      return -1;
+    if ((audioSpec.format != AUDIO_F32SYS) && (audioSpec.format != AUDIO_S16SYS)) {
+      av_log (NULL, AV_LOG_VERBOSE, "SDL advised audio format 0x%x, reopening with %s\n",
+                                    audioSpec.format, gAudioFloat ? "f32" : "s16");
+      SDL_CloseAudioDevice (gAudioDevice);
+      allowedChanges &= ~SDL_AUDIO_ALLOW_FORMAT_CHANGE;
+      wantedAudioSpec.freq = audioSpec.freq;
+      wantedAudioSpec.channels = audioSpec.channels;
+      if (!(gAudioDevice = SDL_OpenAudioDevice (NULL, 0, &wantedAudioSpec, &audioSpec, allowedChanges))) {
+        //{{{  error return
+        av_log (NULL, AV_LOG_ERROR, "SDL_OpenAudio (%d channels, %d Hz): %s\n",
+                                    wantedAudioSpec.channels, wantedAudioSpec.freq, SDL_GetError());
+        return -1;
+        }
+        //}}}
       }
-      //}}}
 
     if (audioSpec.channels != wantedAudioSpec.channels) {
       av_channel_layout_uninit (wantedChannelLayout);
@@ -1891,7 +4527,8 @@ public:
         //}}}
       }
 
-    audio_hw_params->fmt = AV_SAMPLE_FMT_S16;
+    audio_hw_samples = audioSpec.samples;
+    audio_hw_params->fmt = (audioSpec.format == AUDIO_F32SYS) ? AV_SAMPLE_FMT_FLT : AV_SAMPLE_FMT_S16;
     audio_hw_params->freq = audioSpec.freq;
     if (av_channel_layout_copy (&audio_hw_params->channelLayout, wantedChannelLayout) < 0)
       return -1;
@@ -1905,9 +4542,86 @@ public:
       av_log (NULL, AV_LOG_ERROR, "av_samples_get_buffer_size failed\n");
       return -1;
       }
-      //}}}
+      //}}}
+
+    return audioSpec.size;
+    }
+  //}}}
+  //{{{
+  void audioCallbackJitter (int64_t interval) {
+  // smooth how far callbacks stray from their period, grow the period when they run the device dry
+
+    int64_t period = (int64_t)audio_hw_buf_size * 1000000 / audio_tgt.bytes_per_sec;
+    audio_callback_jitter += (FFABS(interval - period) - audio_callback_jitter) / 16.0;
+
+    // the device holds about two periods, a callback more than a period late has drained it
+    if (interval <= 2 * period)
+      return;
+
+    audio_underruns++;
+    if (gAudioCallbackTime - audio_underrun_window > AUDIO_UNDERRUN_WINDOW) {
+      audio_underrun_window = gAudioCallbackTime;
+      audio_window_underruns = 0;
+      }
+
+    if ((++audio_window_underruns >= AUDIO_UNDERRUN_GROW) && (audio_hw_samples < audio_max_samples)) {
+      audio_window_underruns = 0;
+      SDL_AtomicSet (&audio_grow_samples, FFMIN(audio_hw_samples * 2, audio_max_samples));
+      }
+    }
+  //}}}
+  //{{{
+  void audioReopen (int samples) {
+  // reopen the device with a new period, same format, rate and channels so nothing past the callback changes
+
+    SDL_AudioSpec wantedAudioSpec;
+    SDL_AudioSpec audioSpec;
+
+    wantedAudioSpec.freq = audio_tgt.freq;
+    wantedAudioSpec.channels = (uint8_t)audio_tgt.channelLayout.nb_channels;
+    wantedAudioSpec.format = (audio_tgt.fmt == AV_SAMPLE_FMT_FLT) ? AUDIO_F32SYS : AUDIO_S16SYS;
+    wantedAudioSpec.silence = 0;
+    wantedAudioSpec.samples = (uint16_t)samples;
+    wantedAudioSpec.callback = sdlAudioCallback;
+    wantedAudioSpec.userdata = this;
+
+    SDL_CloseAudioDevice (gAudioDevice);
+    gAudioCallbackTime = 0;
+    if (!(gAudioDevice = SDL_OpenAudioDevice (NULL, 0, &wantedAudioSpec, &audioSpec, SDL_AUDIO_ALLOW_SAMPLES_CHANGE))) {
+      av_log (NULL, AV_LOG_WARNING, "SDL_OpenAudio (%d samples): %s, keeping %d\n",
+                                    samples, SDL_GetError(), audio_hw_samples);
+      // the period that was open a moment ago
+      wantedAudioSpec.samples = (uint16_t)audio_hw_samples;
+      if (!(gAudioDevice = SDL_OpenAudioDevice (NULL, 0, &wantedAudioSpec, &audioSpec, SDL_AUDIO_ALLOW_SAMPLES_CHANGE))) {
+        //{{{  error return, the audio clock would stand still, let the external clock lead
+        av_log (NULL, AV_LOG_ERROR, "SDL_OpenAudio (%d samples): %s, audio lost\n", audio_hw_samples, SDL_GetError());
+        if (av_sync_type == AV_SYNC_AUDIO_MASTER) {
+          double pos = get_master_clock();
+          if (!isnan (pos))
+            extclk.set_clock (pos, extclk.getSerial());
+          av_sync_type = AV_SYNC_EXTERNAL_CLOCK;
+          }
+        SDL_AtomicSet (&audio_device_latency, -1);
+        return;
+        }
+        //}}}
+      }
 
-    return audioSpec.size;
+    av_log (NULL, AV_LOG_VERBOSE, "audio period %d -> %d samples, %d underruns, callback jitter %.2f ms\n",
+                                  audio_hw_samples, audioSpec.samples, audio_underruns, audio_callback_jitter / 1000.0);
+    audio_hw_samples = audioSpec.samples;
+    audio_hw_buf_size = audioSpec.size;
+    audio_diff_threshold = (double)(audio_hw_buf_size) / audio_tgt.bytes_per_sec;
+
+    SDL_PauseAudioDevice (gAudioDevice, 0);
+    pollAudioLatency();
+    }
+  //}}}
+  //{{{
+  void pollAudioLatency() {
+  // SDL_GetAudioDeviceLatency takes the device lock, the callback only reads what this leaves
+
+    SDL_AtomicSet (&audio_device_latency, gAudioDevice ? SDL_GetAudioDeviceLatency (gAudioDevice) : -1);
     }
   //}}}
 
@@ -1925,6 +4639,7 @@ public:
 
     vp->sar = src_frame->sample_aspect_ratio;
     vp->uploaded = 0;
+    vp->scaled = 0;
 
     vp->width = src_frame->width;
     vp->height = src_frame->height;
@@ -1939,6 +4654,7 @@ public:
 
     av_frame_move_ref (vp->frame, src_frame);
     pictq.frame_queue_push();
+    pushRefreshEvent();
 
     return 0;
     }
@@ -1980,9 +4696,9 @@ public:
         if (paused)
           goto display;
 
-        // compute nominal last_duration
-        double last_duration = vp_duration (lastvp, vp);
-        double delay = compute_target_delay (last_duration);
+        // compute nominal last_duration, bench mode shows every frame as soon as it is queued
+        double last_duration = vp_duration (lastvp, vp) / speed;
+        double delay = gBench ? 0.0 : compute_target_delay (last_duration);
 
         time = av_gettime_relative() / 1000000.0;
         if (time < frame_timer + delay) {
@@ -1994,17 +4710,16 @@ public:
         if (delay > 0 && time - frame_timer > AV_SYNC_THRESHOLD_MAX)
           frame_timer = time;
 
-        SDL_LockMutex(pictq.mutex);
         if (!isnan (vp->pts))
           update_video_pts (vp->pts, vp->serial);
-        SDL_UnlockMutex (pictq.mutex);
 
         if (pictq.frame_queue_nb_remaining() > 1) {
           cFrame* nextvp = pictq.frame_queue_peek_next();
-          double duration = vp_duration (vp, nextvp);
+          double duration = vp_duration (vp, nextvp) / speed;
           if (!step && (framedrop>0 || (framedrop && get_master_sync_type() != AV_SYNC_VIDEO_MASTER))
               && time > frame_timer + duration) {
             frame_drops_late++;
+            addTelemetryFrame (TELEMETRY_DROP_LATE, vp->pts, last_duration, delay);
             pictq.frame_queue_next();
             goto retry;
             }
@@ -2043,8 +4758,12 @@ public:
             }
           }
 
+        telemetryPresent = addTelemetryFrame (TELEMETRY_SHOWN, vp->pts, last_duration, delay);
+        seekLanded (vp->serial);
         pictq.frame_queue_next();
         force_refresh = 1;
+        if (gBench)
+          *remaining_time = 0.0;  // poll straight back for the next queued picture
 
         if (step && !paused)
           stream_toggle_pause();
@@ -2056,60 +4775,116 @@ public:
           force_refresh &&
           show_mode == SHOW_MODE_VIDEO && pictq.rindexShown)
         videoDisplay();
+
+      if (telemetryPresent) {
+        // SDL_RenderPresent has returned, with vsync that is the flip
+        if (!gDisplayDisable && show_mode == SHOW_MODE_VIDEO)
+          telemetryPresent->present = gTelemetry.getTime (av_gettime_relative());
+        telemetryPresent = NULL;
+        }
         }
 
     force_refresh = 0;
-    if (gShowStatus) {
-      //{{{  show status
-      AVBPrint buf;
-      static int64_t last_time;
-      int64_t cur_time;
-      int aqsize, vqsize, sqsize;
-      double av_diff;
-
-      cur_time = av_gettime_relative();
-      if (!last_time || (cur_time - last_time) >= 30000) {
-        aqsize = 0;
-        vqsize = 0;
-        sqsize = 0;
-        if (audioStream)
-          aqsize = audioq.size;
-        if (videoStream)
-          vqsize = videoq.size;
-        if (subtitleStream)
-          sqsize = subtitleq.size;
-
-        av_diff = 0;
-        if (audioStream && videoStream)
-          av_diff = audclk.get_clock() - vidclk.get_clock();
-        else if (videoStream)
-          av_diff = get_master_clock() - vidclk.get_clock();
-        else if (audioStream)
-          av_diff = get_master_clock() - audclk.get_clock();
-
-        av_bprint_init (&buf, 0, AV_BPRINT_SIZE_AUTOMATIC);
-        av_bprintf (&buf,
-                   "%7.2f %s:%7.3f fd=%4d aq=%5dKB vq=%5dKB sq=%5dB f=%d/%d   \r",
-                   (float)get_master_clock(),
-                   (audioStream && videoStream) ? "A-V" : (videoStream ? "M-V" : (audioStream ? "M-A" : "   ")),
-                   av_diff,
-                   frame_drops_early + frame_drops_late,
-                   aqsize / 1024, vqsize / 1024, sqsize,
-                   videoStream ? viddec.avctx->pts_correction_num_faulty_dts : 0,
-                   videoStream ? viddec.avctx->pts_correction_num_faulty_pts : 0);
-
-        if (gShowStatus == 1 && AV_LOG_INFO > av_log_get_level())
-          fprintf (stderr, "%s", buf.str);
-        else
-          av_log (NULL, AV_LOG_INFO, "%s", buf.str);
+    }
+  //}}}
+  //{{{
+  sTelemetryFrame* addTelemetryFrame (eTelemetryEvent event, double pts, double duration, double delay) {
+  // record a shown or dropped frame with the sync state and queue depths around it
 
-        fflush(stderr);
-        av_bprint_finalize (&buf, NULL);
+    sTelemetryFrame* record = gTelemetry.addFrame (event);
+    if (!record)
+      return NULL;
+
+    record->pts = pts;
+    record->duration = duration;
+    record->targetDelay = delay;
+    if (event != TELEMETRY_DROP_EARLY)
+      record->deadline = gTelemetry.getTime ((int64_t)(frame_timer * 1000000.0));
+    record->avDiff = get_master_clock() - vidclk.get_clock();
+
+    record->aqSize = audioStream ? audioq.size : 0;
+    record->vqSize = videoStream ? videoq.size : 0;
+    record->sqSize = subtitleStream ? subtitleq.size : 0;
+    record->pictqFrames = pictq.frame_queue_nb_remaining();
+    return record;
+    }
+  //}}}
+  //{{{
+  void showStatus() {
+
+    AVBPrint buf;
+    static int64_t last_time;
+    static int64_t last_wakeup_time;
+    static int64_t last_wakeups;
+    static int wakeups_per_sec;
+    static int64_t last_read_wakeups;
+    static int read_wakeups_per_sec;
+    int64_t cur_time;
+    int aqsize, vqsize, sqsize;
+    double aqsecs, vqsecs;
+    double av_diff;
+
+    cur_time = av_gettime_relative();
+    if (!last_wakeup_time || (cur_time - last_wakeup_time) >= 1000000) {
+      if (last_wakeup_time)
+        wakeups_per_sec = (int)((gEventLoopWakeups - last_wakeups) * 1000000 / (cur_time - last_wakeup_time));
+      if (last_wakeup_time)
+        read_wakeups_per_sec = (int)((gReadWakeups - last_read_wakeups) * 1000000 / (cur_time - last_wakeup_time));
+      last_wakeups = gEventLoopWakeups;
+      last_read_wakeups = gReadWakeups;
+      last_wakeup_time = cur_time;
+      }
 
-        last_time = cur_time;
+    if (!last_time || (cur_time - last_time) >= 30000) {
+      aqsize = 0;
+      vqsize = 0;
+      sqsize = 0;
+      aqsecs = 0;
+      vqsecs = 0;
+      if (audioStream) {
+        aqsize = audioq.size;
+        aqsecs = audioq.duration * av_q2d (audioStream->time_base);
         }
+      if (videoStream) {
+        vqsize = videoq.size;
+        vqsecs = videoq.duration * av_q2d (videoStream->time_base);
+        }
+      if (subtitleStream)
+        sqsize = subtitleq.size;
+
+      av_diff = 0;
+      if (audioStream && videoStream)
+        av_diff = audclk.get_clock() - vidclk.get_clock();
+      else if (videoStream)
+        av_diff = get_master_clock() - vidclk.get_clock();
+      else if (audioStream)
+        av_diff = get_master_clock() - audclk.get_clock();
+
+      av_bprint_init (&buf, 0, AV_BPRINT_SIZE_AUTOMATIC);
+      av_bprintf (&buf,
+                 "%7.2f %5.2fx %s:%7.3f fd=%4d aq=%5dKB/%4.1fs vq=%5dKB/%4.1fs sq=%5dB f=%d/%d wk=%4d/s rd=%3d/s pa=%d/%d sk=%4dms/%d   \r",
+                 (float)get_master_clock(), speed,
+                 (audioStream && videoStream) ? "A-V" : (videoStream ? "M-V" : (audioStream ? "M-A" : "   ")),
+                 av_diff,
+                 frame_drops_early + frame_drops_late,
+                 aqsize / 1024, aqsecs, vqsize / 1024, vqsecs, sqsize,
+                 videoStream ? viddec.avctx->pts_correction_num_faulty_dts : 0,
+                 videoStream ? viddec.avctx->pts_correction_num_faulty_pts : 0,
+                 wakeups_per_sec, read_wakeups_per_sec,
+                 audioq.packetAllocs + videoq.packetAllocs + subtitleq.packetAllocs,
+                 audioq.ringGrows + videoq.ringGrows + subtitleq.ringGrows,
+                 (int)(seekLatency / 1000), seekSuperseded + seekCancelled);
+
+      if (gShowStatus == 1 && AV_LOG_INFO > av_log_get_level())
+        fprintf (stderr, "%s", buf.str);
+      else
+        av_log (NULL, AV_LOG_INFO, "%s", buf.str);
+
+      fflush(stderr);
+      av_bprint_finalize (&buf, NULL);
+
+      last_time = cur_time;
       }
-      //}}}
     }
   //}}}
 
@@ -2223,12 +4998,15 @@ public:
         }
 
         /* prepare audio output */
-        if (ret = (audioOpen (&ch_layout, sample_rate, &audio_tgt)) < 0)
+        if ((ret = audioOpen (&ch_layout, sample_rate, &audio_tgt)) < 0)
           goto fail;
         audio_hw_buf_size = ret;
         audio_src = audio_tgt;
-        audio_buf_size  = 0;
-        audio_buf_index = 0;
+
+        // room for a few of the largest callbacks even when -lowlatency grows the period
+        if ((ret = audioRing.init (FFMAX(audio_tgt.bytes_per_sec / 1000 * AUDIO_RING_MS,
+                                         4 * audio_max_samples * audio_tgt.frame_size), &audioq)) < 0)
+          goto fail;
 
         /* init averaging filter */
         audio_diff_avg_coef  = exp(log(0.01) / AUDIO_DIFF_AVG_NB);
@@ -2253,6 +5031,7 @@ public:
           goto out;
 
         SDL_PauseAudioDevice (gAudioDevice, 0);
+        pollAudioLatency();
         break;
       //}}}
       //{{{
@@ -2263,6 +5042,7 @@ public:
         if ((ret = viddec.decoderInit (avctx, &videoq,
                                 continueReadThread)) < 0)
           goto fail;
+        viddec.setTrickSkip (trickSkip());
 
         if ((ret = viddec.decoderStart (videoThread, "video_decoder", this)) < 0)
           goto out;
@@ -2389,19 +5169,50 @@ public:
     }
   //}}}
   //{{{
-  void streamSeek (int64_t pos, int64_t rel, int by_bytes) {
-  /* seek in the stream */
+  void streamSeek (int64_t pos, int64_t rel, int by_bytes, bool indexed = false) {
+  // a mailbox, the latest request replaces one not yet served and cancels the read or seek in flight
+  // - indexed, a time seek only because the keyframe index was usable, past its end it guesses a byte seek
+
+    SDL_AtomicLock (&seekLock);
+    if (seek_req)
+      seekSuperseded++;
+
+    // a relative request on top of one still pending is relative to where playback still is
+    seek_rel = (seek_req && rel && seek_rel) ? seek_rel + rel : rel;
+    seek_pos = pos;
+    seek_flags &= ~AVSEEK_FLAG_BYTE;
+    if (by_bytes)
+      seek_flags |= AVSEEK_FLAG_BYTE;
+    seekIndexed = indexed;
+    seek_req = 1;
+    seekRequestTime = av_gettime_relative();
+    SDL_AtomicIncRef (&seekSerial);
+    SDL_AtomicUnlock (&seekLock);
+
+    SDL_CondSignal (continueReadThread);
+    }
+  //}}}
+  //{{{
+  bool seekPending() {
+  // requested, or served with its first frame still to come, new relative seeks start from its target
 
-    if (!seek_req) {
-      seek_pos = pos;
-      seek_rel = rel;
-      seek_flags &= ~AVSEEK_FLAG_BYTE;
-      if (by_bytes)
-        seek_flags |= AVSEEK_FLAG_BYTE;
-      seek_req = 1;
+    return seek_req || SDL_AtomicGet (&seekLanding);
+    }
+  //}}}
+  //{{{
+  void seekLanded (int serial) {
+  // the first frame or audio of a served seek is out, timed from the request that won
 
-      SDL_CondSignal (continueReadThread);
-      }
+    if (!SDL_AtomicGet (&seekLanding) || (serial != seekLandingSerial) || !SDL_AtomicCAS (&seekLanding, 1, 0))
+      return;
+
+    seekLatency = av_gettime_relative() - seekLandingRequestTime;
+    seekLatencyMax = FFMAX(seekLatencyMax, seekLatency);
+    seekLatencySum += seekLatency;
+    seeksLanded++;
+    av_log (NULL, AV_LOG_VERBOSE, "seek to first frame %.1fms, avg %.1fms max %.1fms, %d superseded %d cancelled\n",
+            seekLatency / 1000.0, seekLatencySum / 1000.0 / seeksLanded, seekLatencyMax / 1000.0,
+            seekSuperseded, seekCancelled);
     }
   //}}}
   //{{{
@@ -2435,15 +5246,21 @@ public:
     switch (codecParameters->codec_type) {
       //{{{
       case AVMEDIA_TYPE_AUDIO:
-        auddec.decoderAbort (&sampq);
-
+        // the audio thread waits on the ring, not a frame queue
+        audioq.packet_queue_abort();
+        audioRing.signal();
+        auddec.decoderAbort (NULL);
+
+        if (gLowLatency)
+          av_log (NULL, AV_LOG_VERBOSE, "audio period %d samples, %d underruns, callback jitter %.2f ms\n",
+                                        audio_hw_samples, audio_underruns, audio_callback_jitter / 1000.0);
         SDL_CloseAudioDevice (gAudioDevice);
         auddec.decoderDestroy();
         swr_free (&swrContext);
         av_freep (&audio_buf1);
+        audioRing.destroy();
 
         audio_buf1_size = 0;
-        audio_buf = NULL;
         if (rdft) {
           av_tx_uninit (&rdft);
           av_freep (&real_data);
@@ -2515,6 +5332,10 @@ public:
       streamComponentClose (subtitleStreamId);
 
     avformat_close_input (&formatContext);
+    thumbnailer.close();
+    keyframeIndex.close();
+    mmapInput.close();
+    asyncInput.close();
 
     videoq.packet_queue_destroy();
     audioq.packet_queue_destroy();
@@ -2522,20 +5343,23 @@ public:
 
     /* free all pictures */
     pictq.frame_queue_destroy();
-    sampq.frame_queue_destroy();
     subpq.frame_queue_destroy();
 
     SDL_DestroyCond (continueReadThread);
     sws_freeContext (sub_convert_ctx);
+    sws_freeContext (scale_convert_ctx);
 
     av_free (filename);
 
     if (visTexture)
       SDL_DestroyTexture (visTexture);
-    if (vidTexture)
-      SDL_DestroyTexture (vidTexture);
+    for (int i = 0; i < VIDEO_PICTURE_QUEUE_SIZE; i++)
+      if (vidTextures[i])
+        SDL_DestroyTexture (vidTextures[i]);
     if (subTexture)
       SDL_DestroyTexture (subTexture);
+    if (scaledTexture)
+      SDL_DestroyTexture (scaledTexture);
     av_free (this);
     }
   //}}}
@@ -2543,7 +5367,7 @@ public:
   //{{{
   void drawVideoAudioDisplay() {
 
-    int i, i_start, x, y1, y, ys, delay, n, nb_display_channels;
+    int i, i_start, x, y1, y, ys, delay, nb_display_channels;
     int ch, h, h2;
 
     int newRdftBbits;
@@ -2555,9 +5379,8 @@ public:
     nb_display_channels = channels;
     if (!paused) {
       int data_used = show_mode == SHOW_MODE_WAVES ? width : (2*nb_freq);
-      n = 2 * channels;
-      delay = audio_write_buf_size;
-      delay /= n;
+      // sample_array is fed as the callback plays, nothing in it is ahead of the output
+      delay = 0;
 
       /* to be more precise, we take into account the time spent since the last buffer computation */
       int64_t time_diff = 0;
@@ -2705,6 +5528,109 @@ public:
     }
   //}}}
   //{{{
+  int uploadPicture (cFrame* vp) {
+  // upload a picture into the texture of its pictq slot, once
+
+    if (vp->uploaded)
+      return 0;
+
+    int64_t uploadStart = gBench ? getBenchTime() : 0;
+    setSdlYuvConversionMode (vp->frame);
+    int ret = uploadTexture (&vidTextures[pictq.frame_queue_slot (vp)], vp->frame);
+    setSdlYuvConversionMode (NULL);
+    if (ret < 0)
+      return ret;
+    if (gBench)
+      gBenchStages[BENCH_UPLOAD].add (uploadStart);
+
+    vp->uploaded = 1;
+    vp->flip_v = vp->frame->linesize[0] < 0;
+    return 0;
+    }
+  //}}}
+  //{{{
+  int isScaledDisplay (cFrame* vp, SDL_Rect* rect) {
+  // the software renderer converts a frame at its own size, then stretches it again into the window surface
+  // - when the display rect differs, uploadScaledPicture does both in one sws pass instead
+
+    calculateDisplayRect (rect, xleft, ytop, width, height, vp->width, vp->height, vp->sar);
+    return (gRendererInfo.flags & SDL_RENDERER_SOFTWARE) && ((rect->w != vp->width) || (rect->h != vp->height));
+    }
+  //}}}
+  //{{{
+  int uploadScaledPicture (cFrame* vp, SDL_Rect* rect) {
+  // convert and bilinear scale a picture straight into a display rect sized texture, copied 1:1 to the window
+  // - the decoder's yuv reaches here unconverted, configureVideoFilters passes it through for the software renderer
+
+    int w, h;
+    if (vp->scaled && (scaledFrame == vp) &&
+        !SDL_QueryTexture (scaledTexture, NULL, NULL, &w, &h) && (w == rect->w) && (h == rect->h))
+      // a redraw of the same picture at the same size
+      return 0;
+
+    AVFrame* frame = vp->frame;
+
+    Uint32 sdlPixelFormat;
+    SDL_BlendMode sdl_blendmode;
+    getSdlPixfmtAndBlendmode (frame->format, &sdlPixelFormat, &sdl_blendmode);
+    if (reallocTexture (&scaledTexture, SDL_PIXELFORMAT_ARGB8888, rect->w, rect->h, sdl_blendmode, 0) < 0)
+      return -1;
+
+    scale_convert_ctx = sws_getCachedContext (scale_convert_ctx,
+                                              frame->width, frame->height, (AVPixelFormat)frame->format,
+                                              rect->w, rect->h, AV_PIX_FMT_RGB32,
+                                              SWS_BILINEAR, NULL, NULL, NULL);
+    if (!scale_convert_ctx) {
+      //{{{  error return
+      av_log (NULL, AV_LOG_FATAL, "Cannot initialize the conversion context\n");
+      return -1;
+      }
+      //}}}
+
+    // same matrix choice as setSdlYuvConversionMode, unknown colorspaces fall back to the sws default
+    sws_setColorspaceDetails (scale_convert_ctx,
+                              sws_getCoefficients (frame->colorspace), frame->color_range == AVCOL_RANGE_JPEG,
+                              sws_getCoefficients (SWS_CS_DEFAULT), 1,
+                              0, 1 << 16, 1 << 16);
+
+    uint8_t* pixels[4] = { NULL };
+    int pitch[4] = { 0 };
+    if (SDL_LockTexture (scaledTexture, NULL, (void**)pixels, pitch) < 0)
+      return -1;
+
+    // sws reads negative linesizes bottom up, so the result needs no flip
+    sws_scale (scale_convert_ctx, (const uint8_t* const*)frame->data, frame->linesize,
+               0, frame->height, pixels, pitch);
+    SDL_UnlockTexture (scaledTexture);
+
+    scaledFrame = vp;
+    vp->scaled = 1;
+    return 0;
+    }
+  //}}}
+  //{{{
+  void preUploadPictures() {
+  // upload queued pictures ahead of their display deadline, off the vsync critical path
+  // - render calls must stay on this thread, queuePicture only wakes us with FF_REFRESH_EVENT
+  // - the producer never writes the slots between rindex and rindex + size, so they are ours to read
+
+    if (gDisplayDisable || !videoStream || (audioStream && (show_mode != SHOW_MODE_VIDEO)))
+      return;
+
+    int remaining = pictq.frame_queue_nb_remaining();
+    for (int i = 0; i < remaining; i++) {
+      cFrame* vp = pictq.frame_queue_peek_offset (i);
+      if (vp->serial != videoq.serial)
+        continue; // stale after a seek, videoRefresh drops it unshown
+      SDL_Rect rect;
+      if (isScaledDisplay (vp, &rect))
+        continue; // scaled at draw time, straight to the display rect
+      if (uploadPicture (vp) < 0)
+        return;
+      }
+    }
+  //}}}
+  //{{{
   void drawVideoDisplay() {
 
     cFrame* vp = pictq.frame_queue_peek_last();
@@ -2760,20 +5686,21 @@ public:
       //}}}
 
     SDL_Rect rect;
-    calculateDisplayRect (&rect, xleft, ytop, width, height, vp->width, vp->height, vp->sar);
-    setSdlYuvConversionMode (vp->frame);
-
-    if (!vp->uploaded) {
-      if (uploadTexture (&vidTexture, vp->frame) < 0) {
-        setSdlYuvConversionMode (NULL);
+    if (isScaledDisplay (vp, &rect)) {
+      if (uploadScaledPicture (vp, &rect) < 0)
         return;
-        }
-      vp->uploaded = 1;
-      vp->flip_v = vp->frame->linesize[0] < 0;
+      SDL_RenderCopy (gRenderer, scaledTexture, NULL, &rect);
       }
+    else {
+      // normally preUploadPictures has already filled the slot texture, then this is only the swap
+      if (uploadPicture (vp) < 0)
+        return;
 
-    SDL_RenderCopyEx (gRenderer, vidTexture, NULL, &rect, 0, NULL, vp->flip_v ? SDL_FLIP_VERTICAL : (SDL_RendererFlip)0);
-    setSdlYuvConversionMode (NULL);
+      setSdlYuvConversionMode (vp->frame);
+      SDL_RenderCopyEx (gRenderer, vidTextures[pictq.frame_queue_slot (vp)], NULL, &rect, 0, NULL,
+                        vp->flip_v ? SDL_FLIP_VERTICAL : (SDL_RendererFlip)0);
+      setSdlYuvConversionMode (NULL);
+      }
 
     if (sp)
       SDL_RenderCopy (gRenderer, subTexture, NULL, &rect);
@@ -2786,6 +5713,8 @@ public:
     if (!width)
       videoOpen();
 
+    // upload is timed on its own in uploadPicture, normally preUploadPictures has done it already
+    int64_t renderStart = gBench ? getBenchTime() : 0;
     SDL_SetRenderDrawColor (gRenderer, 0, 0, 0, 255);
     SDL_RenderClear (gRenderer);
 
@@ -2793,11 +5722,103 @@ public:
       drawVideoAudioDisplay();
     else if (videoStream)
       drawVideoDisplay();
+    if (scrubbing)
+      drawThumbnail();
 
+    cTraceSpan presentSpan ("render", "SDL_RenderPresent");
     SDL_RenderPresent (gRenderer);
+    presentSpan.end();
+    if (gBench)
+      gBenchStages[BENCH_RENDER].add (renderStart);
+    }
+  //}}}
+
+  //{{{
+  void seekToX (double x) {
+  // seek to the fraction of the file x is across the window
+
+    if (seek_by_bytes || formatContext->duration <= 0) {
+      uint64_t size =  avio_size(formatContext->pb);
+      streamSeek ((int64_t)(size * x /width), 0, 1);
+      }
+
+    else {
+      int tns  = (int)(formatContext->duration / 1000000LL);
+      int thh  = tns / 3600;
+      int tmm  = (tns % 3600) / 60;
+      int tss  = (tns % 60);
+
+      double frac = x / width;
+      int ns = (int)(frac * tns);
+      int hh = ns / 3600;
+      int mm = (ns % 3600) / 60;
+      int ss = (ns % 60);
+
+      av_log (NULL, AV_LOG_INFO,
+              "Seek to %2.0f%% (%2d:%02d:%02d) of total duration (%2d:%02d:%02d)       \n", frac*100,
+              hh, mm, ss, thh, tmm, tss);
+
+      int64_t ts = (int64_t)(frac * formatContext->duration);
+      if (formatContext->start_time != AV_NOPTS_VALUE)
+        ts += formatContext->start_time;
+      streamSeek (ts, 0, 0);
+      }
+    }
+  //}}}
+  //{{{
+  int64_t guessBytePos (int64_t ts) {
+  // byte offset of ts at the average bitrate, -1 without one
+
+    if (formatContext->bit_rate <= 0)
+      return -1;
+
+    if (formatContext->start_time != AV_NOPTS_VALUE)
+      ts -= formatContext->start_time;
+    int64_t pos = FFMAX(av_rescale (ts, formatContext->bit_rate, 8 * AV_TIME_BASE), 0);
+
+    int64_t size = avio_size (formatContext->pb);
+    return size > 0 ? FFMIN(pos, size) : pos;
+    }
+  //}}}
+  //{{{
+  bool scrub (double x) {
+  // right drag, preview the thumbnail at x, the seek waits for the button release
+
+    if (!videoStream || realtime || (formatContext->duration <= 0)
+        || (videoStream->disposition & AV_DISPOSITION_ATTACHED_PIC))
+      return false;
+    if (!thumbnailer.isOpen() && (thumbnailer.open (filename, formatContext->iformat, videoStreamId, &keyframeIndex) < 0))
+      return false;
+
+    scrubbing = true;
+    scrubX = x;
+    scrubTs = (int64_t)(av_clipd (x / width, 0.0, 1.0) * formatContext->duration);
+    if (formatContext->start_time != AV_NOPTS_VALUE)
+      scrubTs += formatContext->start_time;
+    thumbnailer.request (scrubTs);
+    force_refresh = 1;
+    return true;
     }
   //}}}
+  //{{{
+  void drawThumbnail() {
+  // the scrub target's thumbnail above the bottom edge, centred on the pointer
+
+    int w, h;
+    SDL_Texture* texture = thumbnailer.getTexture (scrubTs, &w, &h);
+    if (!texture)
+      return;
 
+    SDL_Rect rect;
+    rect.w = w;
+    rect.h = h;
+    rect.x = av_clip ((int)scrubX - w / 2, 0, FFMAX(width - w, 0));
+    rect.y = FFMAX(height - h - THUMBNAIL_MARGIN, 0);
+    SDL_RenderCopy (gRenderer, texture, NULL, &rect);
+    SDL_SetRenderDrawColor (gRenderer, 255, 255, 255, 255);
+    SDL_RenderDrawRect (gRenderer, &rect);
+    }
+  //}}}
   //{{{
   void seekChapter (int incr) {
 
@@ -2849,6 +5870,103 @@ public:
     }
   //}}}
   //{{{
+  enum AVDiscard trickSkip() {
+  // what the video decoder may skip at this speed
+
+    if (speed >= gTrickKeyframeSpeed)
+      return AVDISCARD_NONKEY;
+    else if (speed >= TRICK_NONREF_SPEED)
+      return AVDISCARD_NONREF;
+    return AVDISCARD_DEFAULT;
+    }
+  //}}}
+  //{{{
+  void setSpeed (double newSpeed) {
+  // every clock runs at speed, the audio is time stretched while it can keep up, muted past that,
+  // the video decode sheds frames as the speed rises
+  // - restarts reading from the current position, what was read ahead at the old speed is flushed
+
+    newSpeed = av_clipd (newSpeed, SPEED_MIN, TRICK_SPEED_MAX);
+    if (realtime || (newSpeed == speed))
+      return;
+    if (!videoStream && ((newSpeed < stretchSpeedMin) || (newSpeed > stretchSpeedMax)))
+      return;
+
+    speed = newSpeed;
+    applySpeed();
+
+    av_log (NULL, AV_LOG_INFO, "speed %gx%s%s\n", speed,
+            SDL_AtomicGet (&trickAudioMuted) ? ", audio muted" : "",
+            trickSkip() == AVDISCARD_NONKEY ? ", keyframes only" : trickSkip() == AVDISCARD_NONREF ? ", referenced frames only" : "");
+    }
+  //}}}
+  //{{{
+  void stepSpeed (int dir) {
+  // ] and [, the next speed step up or down
+
+    int steps = FF_ARRAY_ELEMS(gSpeedSteps);
+    if (dir > 0) {
+      for (int i = 0; i < steps; i++)
+        if (gSpeedSteps[i] > speed) {
+          setSpeed (gSpeedSteps[i]);
+          return;
+          }
+      }
+    else {
+      for (int i = steps - 1; i >= 0; i--)
+        if (gSpeedSteps[i] < speed) {
+          setSpeed (gSpeedSteps[i]);
+          return;
+          }
+      }
+    }
+  //}}}
+  //{{{
+  void applySpeed() {
+  // point the clocks, decoders and audio stretch at speed
+
+    double pos = get_master_clock();
+
+    int stretch = audioStream && (speed >= stretchSpeedMin) && (speed <= stretchSpeedMax);
+    SDL_AtomicSet (&stretchTempo, stretch ? (int)lrint (speed * 1000.0) : 1000);
+    SDL_AtomicSet (&trickAudioMuted, !stretch && (speed != 1.0));
+    SDL_AtomicSet (&trickKeyframesOnly, trickSkip() == AVDISCARD_NONKEY);
+    viddec.setTrickSkip (trickSkip());
+
+    // the external clock leads while the audio is muted, it carries on from the master
+    if (!isnan (pos))
+      extclk.set_clock (pos, extclk.getSerial());
+    vidclk.set_clock_speed (speed);
+    audclk.set_clock_speed (speed);
+    extclk.set_clock_speed (speed);
+
+    if (!isnan (pos))
+      streamSeek ((int64_t)(pos * AV_TIME_BASE), 0, 0);
+    }
+  //}}}
+  //{{{
+  void capStretch() {
+  // the audio thread can't stretch this speed in time, mute it here and at every speed further from 1x
+
+    if ((speed == 1.0) || SDL_AtomicGet (&trickAudioMuted))
+      return;
+
+    av_log (NULL, AV_LOG_WARNING, "audio stretch at %gx took %.0f%% of the audio time, muting the audio at %gx%s\n",
+            speed, stretchLoad * 100.0, speed, speed > 1.0 ? " and above" : " and below");
+
+    if (speed > 1.0)
+      stretchSpeedMax = FFMIN(stretchSpeedMax, nextafter (speed, 1.0));
+    else
+      stretchSpeedMin = FFMAX(stretchSpeedMin, nextafter (speed, 1.0));
+
+    if (!videoStream)
+      // nothing left to play muted, back off to 1x
+      setSpeed (1.0);
+    else
+      applySpeed();
+    }
+  //}}}
+  //{{{
   void updateVolume (int sign, double newStep) {
 
     double volume_level = audio_volume ? (20 * log(audio_volume / (double)SDL_MIX_MAXVOLUME) / log(10)) : -1000.0;
@@ -2885,6 +6003,12 @@ public:
 
     streamClose();
 
+    gUploadPool.exit();
+    gTelemetry.exit();
+    gTrace.exit();
+    if (gBench)
+      benchReport();
+
     if (gRenderer)
       SDL_DestroyRenderer (gRenderer);
 
@@ -2911,47 +6035,73 @@ private:
 
     cVideoState* videoState = (cVideoState*)opaque;
 
+    gTrace.useThreadBuffer (gAudioTraceBuffer);
+    cTraceSpan span ("audio", "sdlAudioCallback");
+
+    int64_t lastCallbackTime = gAudioCallbackTime;
     gAudioCallbackTime = av_gettime_relative();
+    if (gLowLatency && lastCallbackTime)
+      videoState->audioCallbackJitter (gAudioCallbackTime - lastCallbackTime);
+
+    // frames the backend has queued ahead of this buffer, -1 when it can't tell
+    int deviceLatency = SDL_AtomicGet (&videoState->audio_device_latency);
+    if (gTelemetry.isEnabled()) {
+      // the previous callback's len is what this one should have waited for
+      gTelemetry.addAudioCallback (gAudioCallbackTime,
+                                   lastCallbackTime ? (int64_t)videoState->audio_callback_len * 1000000 / videoState->audio_tgt.bytes_per_sec : 0,
+                                   videoState->audio_write_buf_size, videoState->audioq.size);
+      videoState->audio_callback_len = len;
+      }
 
+    // only copies out of the ring, the audio thread has already converted it
+    cAudioRing* ring = &videoState->audioRing;
     while (len > 0) {
-      if (videoState->audio_buf_index >= (int)videoState->audio_buf_size) {
-        int audio_size = videoState->audioDecodeFrame();
-        if (audio_size < 0) {
-          // if error, just output silence
-          videoState->audio_buf = NULL;
-          videoState->audio_buf_size = SDL_AUDIO_MIN_BUFFER_SIZE / videoState->audio_tgt.frame_size * videoState->audio_tgt.frame_size;
-          }
-        else {
-          if (videoState->show_mode != SHOW_MODE_VIDEO)
-            videoState->update_sample_display ((int16_t*)videoState->audio_buf, audio_size);
-          videoState->audio_buf_size = audio_size;
-          }
-        videoState->audio_buf_index = 0;
+      const cAudioRing::sChunk* chunk = videoState->paused ? NULL : ring->chunk();
+      if (!chunk) {
+        // paused or the audio thread is behind, play silence rather than wait
+        memset (stream, 0, len);
+        break;
+        }
+      if (chunk->serial != videoState->audioq.serial) {
+        // converted before a seek
+        ring->skip (chunk);
+        continue;
         }
 
-      int len1 = videoState->audio_buf_size - videoState->audio_buf_index;
+      int len1;
+      const uint8_t* src = ring->readable (chunk, &len1);
       if (len1 > len)
         len1 = len;
 
-      if (!videoState->muted && videoState->audio_buf && videoState->audio_volume == SDL_MIX_MAXVOLUME)
-        memcpy (stream, (uint8_t *)videoState->audio_buf + videoState->audio_buf_index, len1);
-      else {
+      if (videoState->show_mode != SHOW_MODE_VIDEO)
+        videoState->update_sample_display (src, len1);
+
+      if (videoState->muted || !videoState->audio_volume)
         memset (stream, 0, len1);
-        if (!videoState->muted && videoState->audio_buf)
-          SDL_MixAudioFormat (stream, (uint8_t *)videoState->audio_buf + videoState->audio_buf_index, AUDIO_S16SYS, len1, videoState->audio_volume);
-        }
+      else if (videoState->audio_volume == SDL_MIX_MAXVOLUME)
+        memcpy (stream, src, len1);
+      else
+        applyVolume (stream, src, len1, videoState->audio_tgt.fmt, videoState->audio_volume);
 
+      ring->consume (chunk, len1);
       len -= len1;
       stream += len1;
-      videoState->audio_buf_index += len1;
       }
 
-    videoState->audio_write_buf_size = videoState->audio_buf_size - videoState->audio_buf_index;
+    const cAudioRing::sChunk* playing = ring->playing (&videoState->audio_write_buf_size);
+    videoState->audio_clock = playing->clock;
+    videoState->audio_clock_serial = playing->serial;
+    if (!videoState->videoStream)
+      videoState->seekLanded (playing->serial);
 
-    // Let's assume the audio driver that is used by SDL has two periods
+    // this buffer plays after what the backend has queued, else assume the usual two periods
+    int latencyBytes = 2 * videoState->audio_hw_buf_size;
+    if (deviceLatency >= 0)
+      latencyBytes = deviceLatency * videoState->audio_tgt.frame_size + videoState->audio_hw_buf_size;
     if (!isnan (videoState->audio_clock)) {
-      videoState->audclk.set_clock_at (videoState->audio_clock - (double)(2 * videoState->audio_hw_buf_size + videoState->audio_write_buf_size) /
-                                       videoState->audio_tgt.bytes_per_sec,
+      // what is queued plays in tempo times its duration of the media, at the stretch the playing chunk was made at
+      videoState->audclk.set_clock_at (videoState->audio_clock - (double)(latencyBytes + videoState->audio_write_buf_size) /
+                                       videoState->audio_tgt.bytes_per_sec * playing->tempo,
                                        videoState->audio_clock_serial, gAudioCallbackTime / 1000000.0);
 
       videoState->extclk.sync_clock_to_slave ( &videoState->audclk);
@@ -2962,6 +6112,7 @@ private:
   static int videoThread (void* arg) {
 
     cVideoState* videoState = (cVideoState*)arg;
+    gTrace.setThreadName ("video");
     AVFrame* frame = av_frame_alloc();
 
     AVRational tb = videoState->videoStream->time_base;
@@ -2984,11 +6135,15 @@ private:
     double duration;
     int ret;
     for (;;) {
+      // includes waiting on videoq, in bench mode readThread is never the one holding back
+      int64_t decodeStart = gBench ? getBenchTime() : 0;
       ret = videoState->getVideoFrame (frame);
       if (ret < 0)
         goto the_end;
       if (!ret)
         continue;
+      if (gBench)
+        gBenchStages[BENCH_DECODE].add (decodeStart);
 
       if (last_w != frame->width
           || last_h != frame->height
@@ -3034,7 +6189,10 @@ private:
         }
         //}}}
 
+      int64_t filterStart = gBench ? getBenchTime() : 0;
+      cTraceSpan addSpan ("video", "av_buffersrc_add_frame");
       ret = av_buffersrc_add_frame (filt_in, frame);
+      addSpan.end();
       if (ret < 0)
         goto the_end;
 
@@ -3042,7 +6200,11 @@ private:
         //{{{  queue picture
         videoState->frame_last_returned_time = av_gettime_relative() / 1000000.0;
 
+        cTraceSpan getSpan ("video", "av_buffersink_get_frame_flags");
         ret = av_buffersink_get_frame_flags (filt_out, frame, 0);
+        getSpan.end();
+        if (gBench && (ret >= 0))
+          gBenchStages[BENCH_FILTER].add (filterStart);
         if (ret < 0) {
           if (ret == AVERROR_EOF)
             videoState->viddec.finished = videoState->viddec.pkt_serial;
@@ -3063,6 +6225,7 @@ private:
                             frameData ? frameData->pkt_pos : -1, videoState->viddec.pkt_serial);
 
         av_frame_unref (frame);
+        filterStart = gBench ? getBenchTime() : 0;  // the next frame out of the sink, not the wait in queuePicture
 
         if (videoState->videoq.serial != videoState->viddec.pkt_serial)
           break;
@@ -3082,21 +6245,27 @@ private:
   static int audioThread (void* arg) {
 
     cVideoState* videoState = (cVideoState*)arg;
+    gTrace.setThreadName ("audio");
 
     AVFrame* frame = av_frame_alloc();
     if (!frame)
       return AVERROR(ENOMEM);
 
     int ret = 0;
+    int last_serial = -1;
+    double tempoStart = NAN;   // first pts into atempo, its output pts count played time from there
+    int64_t stretchCost = 0;   // us spent filtering this window
+    double stretchMade = 0.0;  // seconds of audio the filter made this window
     do {
       int gotFrame;
       if ((gotFrame = videoState->auddec.decodeFrame (frame, NULL)) < 0)
         goto the_end;
 
-      int last_serial = -1;
       if (gotFrame) {
         //{{{  got frame
         AVRational tb = {1, frame->sample_rate};
+        if (videoState->auddec.dropPreroll (frame, frame->pts + frame->nb_samples - 1, tb))
+          continue;
 
         int reconfigure = compareAudioFormats (videoState->audio_filter_src.fmt,
                                                videoState->audio_filter_src.channelLayout.nb_channels,
@@ -3104,7 +6273,8 @@ private:
                                                frame->ch_layout.nb_channels)
                          || av_channel_layout_compare (&videoState->audio_filter_src.channelLayout, &frame->ch_layout)
                          || videoState->audio_filter_src.freq != frame->sample_rate
-                         || videoState->auddec.pkt_serial != last_serial;
+                         || videoState->auddec.pkt_serial != last_serial
+                         || SDL_AtomicGet (&videoState->stretchTempo) != lrint (videoState->audioTempo * 1000.0);
         if (reconfigure) {
           //{{{  reconfigure audio
           char buf1[1024], buf2[1024];
@@ -3126,29 +6296,53 @@ private:
           videoState->audio_filter_src.freq = frame->sample_rate;
           last_serial = videoState->auddec.pkt_serial;
 
+          videoState->audioTempo = SDL_AtomicGet (&videoState->stretchTempo) / 1000.0;
+          tempoStart = NAN;
+          stretchCost = 0;
+          stretchMade = 0.0;
+
           if ((ret = videoState->configureAudioFilters (audioFilters, 1)) < 0)
             goto the_end;
           }
           //}}}
 
-        if ((ret = av_buffersrc_add_frame (videoState->inAudioFilter, frame)) < 0)
+        if (isnan (tempoStart) && (frame->pts != AV_NOPTS_VALUE))
+          tempoStart = frame->pts * av_q2d (tb);
+
+        int64_t filterStart = av_gettime_relative();
+        cTraceSpan addSpan ("audio", "av_buffersrc_add_frame");
+        ret = av_buffersrc_add_frame (videoState->inAudioFilter, frame);
+        addSpan.end();
+        stretchCost += av_gettime_relative() - filterStart;
+        if (ret < 0)
           goto the_end;
 
-        while ((ret = av_buffersink_get_frame_flags (videoState->outAudioFilter, frame, 0)) >= 0) {
+        for (;;) {
+          filterStart = av_gettime_relative();
+          cTraceSpan getSpan ("audio", "av_buffersink_get_frame_flags");
+          ret = av_buffersink_get_frame_flags (videoState->outAudioFilter, frame, 0);
+          getSpan.end();
+          stretchCost += av_gettime_relative() - filterStart;
+          if (ret < 0)
+            break;
+
           cFrameData* fd = frame->opaque_ref ? (cFrameData*)frame->opaque_ref->data : NULL;
           tb = av_buffersink_get_time_base (videoState->outAudioFilter);
-
-          cFrame* framePeek;
-          if (!(framePeek = videoState->sampq.frame_queue_peek_writable()))
+          stretchMade += (double)frame->nb_samples / frame->sample_rate;
+
+          // atempo pts advance in played time from its first input, map them back to media time
+          double pts = (frame->pts == AV_NOPTS_VALUE) ? NAN : frame->pts * av_q2d (tb);
+          if ((videoState->audioTempo != 1.0) && !isnan (tempoStart))
+            pts = tempoStart + (pts - tempoStart) * videoState->audioTempo;
+
+          cTraceSpan convertSpan ("audio", "audioConvertFrame");
+          ret = videoState->audioConvertFrame (frame, pts, videoState->auddec.pkt_serial, fd ? fd->pkt_pos : -1);
+          convertSpan.end();
+          av_frame_unref (frame);
+          if (videoState->audioq.abort_request)
             goto the_end;
-
-          framePeek->pts = (frame->pts == AV_NOPTS_VALUE) ? NAN : frame->pts * av_q2d(tb);
-          framePeek->pos = fd ? fd->pkt_pos : -1;
-          framePeek->serial = videoState->auddec.pkt_serial;
-          framePeek->duration = av_q2d ({frame->nb_samples, frame->sample_rate});
-
-          av_frame_move_ref (framePeek->frame, frame);
-          videoState->sampq.frame_queue_push();
+          if (ret < 0)
+            ret = 0; // drop a frame that failed to convert and carry on
 
           if (videoState->audioq.serial != videoState->auddec.pkt_serial)
             break;
@@ -3156,6 +6350,17 @@ private:
 
         if (ret == AVERROR_EOF)
           videoState->auddec.finished = videoState->auddec.pkt_serial;
+
+        if ((videoState->audioTempo != 1.0) && (stretchMade >= AUDIO_STRETCH_WINDOW)) {
+          // the stretch must make its audio well ahead of the callback playing it
+          videoState->stretchLoad = stretchCost / 1000000.0 / stretchMade;
+          av_log (NULL, AV_LOG_DEBUG, "audio stretch %gx load %.0f%%\n",
+                  videoState->audioTempo, videoState->stretchLoad * 100.0);
+          if (videoState->stretchLoad > AUDIO_STRETCH_MAX_LOAD)
+            SDL_AtomicSet (&videoState->stretchOverload, 1);
+          stretchCost = 0;
+          stretchMade = 0.0;
+          }
         }
         //}}}
       } while (ret >= 0 || ret == AVERROR(EAGAIN) || ret == AVERROR_EOF);
@@ -3171,6 +6376,7 @@ private:
   static int subtitleThread (void* arg) {
 
     cVideoState* videoState = (cVideoState*)arg;
+    gTrace.setThreadName ("subtitle");
 
     for (;;) {
       cFrame* subtitleFrame = videoState->subpq.frame_queue_peek_writable();
@@ -3204,6 +6410,15 @@ private:
   //}}}
   //{{{
   static int decodeInterruptCallback (void* ctx) {
+  // once playing, a newer seek request also cuts short the read or seek in flight
+
+    cVideoState* videoState = (cVideoState*)ctx;
+    return videoState->abort_request ||
+           (videoState->seekInterruptible && (SDL_AtomicGet (&videoState->seekSerial) != videoState->seekServedSerial));
+    }
+  //}}}
+  //{{{
+  static int decodeAbortCallback (void* ctx) {
 
     cVideoState* videoState = (cVideoState*)ctx;
     return videoState->abort_request;
@@ -3213,6 +6428,8 @@ private:
   static int readThread (void* arg) {
   // this thread gets the stream from the disk or the network
 
+    gTrace.setThreadName ("read");
+
     int i, ret;
     int err = 0;
     int st_index[AVMEDIA_TYPE_NB];
@@ -3220,6 +6437,7 @@ private:
 
     bool packetInPlayRange = false;
     int scanAllPmtsSet = false;
+    int readAheadPaused = 0;
     int64_t pkt_ts;
 
     cVideoState* videoState = (cVideoState*)arg;
@@ -3261,6 +6479,34 @@ private:
       scanAllPmtsSet = true;
       }
 
+    if (gAsyncIo > 0) {
+      // read ahead on io threads, a url that can't seek through the avformat protocols
+      // the io threads only stop for an abort, a seek cancel there would fail the block being read
+      AVIOInterruptCB abortInterrupt = { decodeAbortCallback, videoState };
+      err = videoState->asyncInput.open (videoState->filename, &abortInterrupt, gAsyncIo);
+      if (err >= 0)
+        formatContext->pb = videoState->asyncInput.getIoContext();
+      else if (err != AVERROR (ENOSYS)) {
+        char errbuf[AV_ERROR_MAX_STRING_SIZE];
+        av_strerror (err, errbuf, sizeof(errbuf));
+        av_log (NULL, AV_LOG_WARNING, "%s: async io failed, %s, reading it on the read thread\n",
+                videoState->filename, errbuf);
+        }
+      }
+
+    if (gMmap && !formatContext->pb) {
+      // local files are read out of a mapping, anything else, or a failed map, through the avformat protocols
+      err = videoState->mmapInput.open (videoState->filename);
+      if (err >= 0)
+        formatContext->pb = videoState->mmapInput.getIoContext();
+      else if (err != AVERROR (ENOSYS)) {
+        char errbuf[AV_ERROR_MAX_STRING_SIZE];
+        av_strerror (err, errbuf, sizeof(errbuf));
+        av_log (NULL, AV_LOG_WARNING, "%s: mmap failed, %s, reading it through the file protocol\n",
+                videoState->filename, errbuf);
+        }
+      }
+
     err = avformat_open_input (&formatContext, videoState->filename, videoState->iformat, &format_opts);
     if (err < 0) {
       //{{{  error
@@ -3406,9 +6652,22 @@ private:
       }
       //}}}
 
+    if (gKeyframeIndex && videoState->videoStream && !videoState->realtime
+        && (formatContext->iformat->flags & AVFMT_TS_DISCONT)
+        && !(formatContext->iformat->flags & AVFMT_NO_BYTE_SEEK)
+        && !avformat_index_get_entries_count (videoState->videoStream))
+      // a transport stream style demuxer with nothing to seek on but timestamp searches
+      videoState->keyframeIndex.open (videoState->filename, formatContext->iformat,
+                                      videoState->videoStreamId, videoState->videoStream->codecpar->codec_id);
+
     if (infinite_buffer < 0 && videoState->realtime)
       infinite_buffer = 1;
 
+    // -speed once the streams are open, the main thread owns the speed, clocks and trick state
+    if (gSpeed != 1.0)
+      SDL_AtomicSet (&videoState->speedRequest, (int)lrint (av_clipd (gSpeed, SPEED_MIN, TRICK_SPEED_MAX) * 1000.0));
+
+    videoState->seekInterruptible = true;
     for (;;) {
       if (videoState->abort_request)
         break;
@@ -3431,14 +6690,53 @@ private:
       #endif
 
       if (videoState->seek_req) {
+        // take the latest request, one arriving from here on cancels this seek
+        SDL_AtomicLock (&videoState->seekLock);
         int64_t seek_target = videoState->seek_pos;
-        int64_t seek_min = videoState->seek_rel > 0 ? seek_target - videoState->seek_rel + 2: INT64_MIN;
-        int64_t seek_max = videoState->seek_rel < 0 ? seek_target - videoState->seek_rel - 2: INT64_MAX;
+        int64_t seek_rel = videoState->seek_rel;
+        int seek_flags = videoState->seek_flags;
+        bool indexed = videoState->seekIndexed;
+        int64_t requestTime = videoState->seekRequestTime;
+        videoState->seekServedSerial = SDL_AtomicGet (&videoState->seekSerial);
+        videoState->seek_req = 0;
+        SDL_AtomicUnlock (&videoState->seekLock);
+
+        int64_t seek_min = seek_rel > 0 ? seek_target - seek_rel + 2: INT64_MIN;
+        int64_t seek_max = seek_rel < 0 ? seek_target - seek_rel - 2: INT64_MAX;
+        bool accurate = gAccurateSeek && !(seek_flags & AVSEEK_FLAG_BYTE);
+        if (accurate)
+          // the keyframe at or before the target, the decoders preroll from there
+          seek_max = FFMIN(seek_max, seek_target);
 
         // FIXME the +-2 is due to rounding being not done in the correct direction in generation
         //      of the seek_pos/seek_rel variables
-        ret = avformat_seek_file (videoState->formatContext, -1, seek_min, seek_target, seek_max, videoState->seek_flags);
-        if (ret < 0)
+        int64_t indexPts;
+        int64_t indexPos;
+        if (!(seek_flags & AVSEEK_FLAG_BYTE)
+            && videoState->keyframeIndex.find (seek_target, seek_min, seek_max, &indexPts, &indexPos)) {
+          // straight to the keyframe's packet, no timestamp search
+          av_log (NULL, AV_LOG_DEBUG, "indexed seek to %0.3f, keyframe %0.3f at %" PRId64 "\n",
+                  seek_target / (double)AV_TIME_BASE, indexPts / (double)AV_TIME_BASE, indexPos);
+          ret = avformat_seek_file (videoState->formatContext, -1, INT64_MIN, indexPos, INT64_MAX, AVSEEK_FLAG_BYTE);
+          }
+        else if (indexed && ((indexPos = videoState->guessBytePos (seek_target)) >= 0)) {
+          // an arrow key past what the index has reached, would have been a byte seek without the index
+          av_log (NULL, AV_LOG_DEBUG, "unindexed seek to %0.3f, guessed at %" PRId64 "\n",
+                  seek_target / (double)AV_TIME_BASE, indexPos);
+          seek_flags |= AVSEEK_FLAG_BYTE;
+          accurate = false;
+          ret = avformat_seek_file (videoState->formatContext, -1, INT64_MIN, indexPos, INT64_MAX, AVSEEK_FLAG_BYTE);
+          }
+        else
+          ret = avformat_seek_file (videoState->formatContext, -1, seek_min, seek_target, seek_max, seek_flags);
+        if ((ret < 0) && videoState->seek_req) {
+          // cancelled by a newer request, served next time round
+          videoState->seekCancelled++;
+          if (formatContext->pb)
+            formatContext->pb->error = 0;
+          continue;
+          }
+        else if (ret < 0)
           av_log (NULL, AV_LOG_ERROR, "%s: error while seeking\n", videoState->formatContext->url);
         else {
           if (videoState->audioStreamId >= 0)
@@ -3447,13 +6745,24 @@ private:
             videoState->subtitleq.packet_queue_flush();
           if (videoState->videoStreamId >= 0)
             videoState->videoq.packet_queue_flush();
-          if (videoState->seek_flags & AVSEEK_FLAG_BYTE)
+          if (seek_flags & AVSEEK_FLAG_BYTE)
             videoState->extclk.set_clock (NAN, 0);
           else
             videoState->extclk.set_clock (seek_target / (double)AV_TIME_BASE, 0);
+
+          if (accurate) {
+            if (videoState->videoStreamId >= 0)
+              videoState->viddec.setPreroll (seek_target, videoState->videoq.serial);
+            if (videoState->audioStreamId >= 0)
+              videoState->auddec.setPreroll (seek_target, videoState->audioq.serial);
+            }
+
+          // the flush bumped the serial, its first frame out lands the seek
+          videoState->seekLandingSerial = videoState->videoStreamId >= 0 ? videoState->videoq.serial : videoState->audioq.serial;
+          videoState->seekLandingRequestTime = requestTime;
+          SDL_AtomicSet (&videoState->seekLanding, 1);
           }
 
-        videoState->seek_req = 0;
         videoState->queue_attachments_req = 1;
         videoState->eof = 0;
         if (videoState->paused)
@@ -3470,22 +6779,35 @@ private:
         videoState->queue_attachments_req = 0;
         }
 
-      /* if the queue are full, no need to read more */
-      if (infinite_buffer<1 &&
-          (videoState->audioq.size + videoState->videoq.size + videoState->subtitleq.size > MAX_QUEUE_SIZE
-          || (videoState->audioq.streamHasEnoughPackets (videoState->audioStream, videoState->audioStreamId) &&
-              videoState->videoq.streamHasEnoughPackets (videoState->videoStream, videoState->videoStreamId) &&
-              videoState->subtitleq.streamHasEnoughPackets (videoState->subtitleStream, videoState->subtitleStreamId)))) {
-         //{{{  wait 10 ms
-         SDL_LockMutex (wait_mutex);
-         SDL_CondWaitTimeout (videoState->continueReadThread, wait_mutex, 10);
-         SDL_UnlockMutex (wait_mutex);
-         continue;
-         }
-         //}}}
+      /* stop reading once every queue is past its high watermark or one is at its byte budget,
+         resume when one drains below its low watermark and all are below half their budget */
+      if (infinite_buffer < 1) {
+        int budget = gReadAheadKB * 1024;
+        int maxQueueSize = FFMAX(videoState->audioq.size, FFMAX(videoState->videoq.size, videoState->subtitleq.size));
+        int audioStreamId = SDL_AtomicGet (&videoState->trickAudioMuted) ? -1 : videoState->audioStreamId;
+        if (!readAheadPaused)
+          readAheadPaused = (maxQueueSize >= budget) ||
+                            (videoState->audioq.streamHasEnoughPackets (videoState->audioStream, audioStreamId) &&
+                             videoState->videoq.streamHasEnoughPackets (videoState->videoStream, videoState->videoStreamId) &&
+                             videoState->subtitleq.streamHasEnoughPackets (videoState->subtitleStream, videoState->subtitleStreamId));
+        else
+          readAheadPaused = (maxQueueSize >= budget / 2) ||
+                            (!videoState->audioq.streamNeedsPackets (videoState->audioStream, audioStreamId) &&
+                             !videoState->videoq.streamNeedsPackets (videoState->videoStream, videoState->videoStreamId) &&
+                             !videoState->subtitleq.streamNeedsPackets (videoState->subtitleStream, videoState->subtitleStreamId));
+        if (readAheadPaused) {
+          //{{{  wait for a decoder to drain its queue, a seek or a pause
+          SDL_LockMutex (wait_mutex);
+          SDL_CondWaitTimeout (videoState->continueReadThread, wait_mutex, READ_AHEAD_WAIT);
+          SDL_UnlockMutex (wait_mutex);
+          gReadWakeups++;
+          continue;
+          }
+          //}}}
+        }
 
       if (!videoState->paused &&
-          (!videoState->audioStream || (videoState->auddec.finished == videoState->audioq.serial && videoState->sampq. frame_queue_nb_remaining() == 0)) &&
+          (!videoState->audioStream || (videoState->auddec.finished == videoState->audioq.serial && videoState->audioRing.empty())) &&
           (!videoState->videoStream || (videoState->viddec.finished == videoState->videoq.serial && videoState->pictq.frame_queue_nb_remaining() == 0))) {
         if (loop != 1 && (!loop || --loop))
           videoState->streamSeek (gStartTime != AV_NOPTS_VALUE ? gStartTime : 0, 0, 0);
@@ -3495,7 +6817,19 @@ private:
           }
         }
 
+      int64_t demuxStart = gBench ? getBenchTime() : 0;
+      cTraceSpan readSpan ("demux", "av_read_frame");
       ret = av_read_frame (formatContext, pkt);
+      readSpan.end();
+      if (gBench && (ret >= 0))
+        gBenchStages[BENCH_DEMUX].add (demuxStart);
+      if ((ret < 0) && videoState->seek_req) {
+        // cut short by a seek request, whatever was half read is flushed by the seek
+        videoState->seekCancelled++;
+        if (formatContext->pb)
+          formatContext->pb->error = 0;
+        continue;
+        }
       if (ret < 0) {
         if ((ret == AVERROR_EOF || avio_feof(formatContext->pb)) && !videoState->eof) {
           if (videoState->videoStreamId >= 0)
@@ -3530,7 +6864,13 @@ private:
                           av_q2d(formatContext->streams[pkt->stream_index]->time_base) -
                           (double)(gStartTime != AV_NOPTS_VALUE ? gStartTime : 0) / 1000000
                           <= ((double)gDuration / 1000000);
-      if (pkt->stream_index == videoState->audioStreamId && packetInPlayRange)
+      // trick play, muted audio isn't decoded, only keyframes past the keyframe speed
+      if ((pkt->stream_index == videoState->audioStreamId) && SDL_AtomicGet (&videoState->trickAudioMuted))
+        av_packet_unref (pkt);
+      else if ((pkt->stream_index == videoState->videoStreamId) && !(pkt->flags & AV_PKT_FLAG_KEY)
+               && SDL_AtomicGet (&videoState->trickKeyframesOnly))
+        av_packet_unref (pkt);
+      else if (pkt->stream_index == videoState->audioStreamId && packetInPlayRange)
         videoState->audioq.packet_queue_put (pkt);
       else if (pkt->stream_index == videoState->videoStreamId && packetInPlayRange
                && !(videoState->videoStream->disposition & AV_DISPOSITION_ATTACHED_PIC))
@@ -3544,8 +6884,12 @@ private:
      ret = 0;
 
   fail:
-    if (formatContext && !videoState->formatContext)
+    if (!videoState->formatContext) {
+      // a failed avformat_open_input has already freed formatContext, never the custom pb
       avformat_close_input (&formatContext);
+      videoState->mmapInput.close();
+      videoState->asyncInput.close();
+      }
 
     av_packet_free (&pkt);
     if (ret != 0) {
@@ -3573,11 +6917,34 @@ public:
 
   int seek_req;
   int seek_flags;
+  bool seekIndexed;            // the pending time seek stands in for a byte seek, see streamSeek
   int64_t seek_pos;
   int64_t seek_rel;
+  SDL_SpinLock seekLock;       // the request fields, streamSeek against the read thread taking them
+  SDL_atomic_t seekSerial;     // bumped per request
+  int seekServedSerial;        // the request the read thread last took
+  bool seekInterruptible;      // past the open, a newer request may cut short a read or seek
+  int64_t seekRequestTime;
+
+  SDL_atomic_t seekLanding;    // served, waiting for its first frame
+  int seekLandingSerial;
+  int64_t seekLandingRequestTime;
+  int64_t seekLatency;
+  int64_t seekLatencyMax;
+  int64_t seekLatencySum;
+  int seeksLanded;
+  int seekSuperseded;
+  int seekCancelled;
   int read_pause_return;
 
   AVFormatContext* formatContext;
+  cMmapInput mmapInput;
+  cAsyncInput asyncInput;
+  cKeyframeIndex keyframeIndex;
+  cThumbnailer thumbnailer;
+  bool scrubbing;
+  double scrubX;
+  int64_t scrubTs;
   int realtime;
 
   int vfilter_idx;
@@ -3593,7 +6960,7 @@ public:
 
   cFrameQueue pictq;
   cFrameQueue subpq;
-  cFrameQueue sampq;
+  cAudioRing audioRing;
 
   cDecoder auddec;
   cDecoder viddec;
@@ -3601,7 +6968,8 @@ public:
 
   SDL_Texture* visTexture;
   SDL_Texture* subTexture;
-  SDL_Texture* vidTexture;
+  SDL_Texture* vidTextures[VIDEO_PICTURE_QUEUE_SIZE];  // one per pictq slot
+  SDL_Texture* scaledTexture;                          // display rect sized, software renderer only
 
   int last_videoStreamId, last_audioStreamId, last_subtitleStreamId;
 
@@ -3614,6 +6982,10 @@ public:
   int videoStreamId;
   AVStream* videoStream;
   cPaxcketQueue videoq;
+  double speed;                   // trick play, every clock runs at it
+  SDL_atomic_t trickAudioMuted;   // audio packets are dropped, the external clock is master
+  SDL_atomic_t trickKeyframesOnly;
+  SDL_atomic_t speedRequest;      // speed * 1000 the read thread asks the main thread for, 0 for none
   double max_frame_duration;      // maximum duration of a frame - above this, we consider the jump a timestamp discontinuity
 
   int av_sync_type;
@@ -3629,12 +7001,9 @@ public:
   AVStream* audioStream;
   cPaxcketQueue audioq;
   int audio_hw_buf_size;
-  uint8_t* audio_buf;
   uint8_t* audio_buf1;
-  unsigned int audio_buf_size; /* in bytes */
   unsigned int audio_buf1_size;
-  int audio_buf_index; /* in bytes */
-  int audio_write_buf_size;
+  int audio_write_buf_size;       // bytes of the ring chunk being played still to play
   int audio_volume;
   int muted;
   cPacket audio_src;
@@ -3643,6 +7012,22 @@ public:
   SwrContext* swrContext;
   int frame_drops_early;
   int frame_drops_late;
+  sTelemetryFrame* telemetryPresent;  // shown frame waiting for its present time
+  int audio_callback_len;             // len of the previous sdlAudioCallback, for its jitter
+  int audio_hw_samples;               // period of the open device
+  int audio_max_samples;              // default period, -lowlatency never grows past it
+  SDL_atomic_t audio_grow_samples;    // period the callback wants, the main thread reopens the device
+  SDL_atomic_t audio_device_latency;  // frames the backend queues ahead of the callback, -1 unknown, the main thread polls it
+  double audioTempo;                  // atempo of the audio filter graph, media seconds per played second, audio thread only
+  SDL_atomic_t stretchTempo;          // atempo * 1000 the audio thread configures, 1000 when not stretching
+  SDL_atomic_t stretchOverload;       // the stretch fell behind, the main thread mutes that speed
+  double stretchLoad;                 // filter time over the audio time it made, last window
+  double stretchSpeedMin;             // speeds the audio is stretched at, narrowed by overloads
+  double stretchSpeedMax;
+  double audio_callback_jitter;       // smoothed |callback interval - period|, us
+  int audio_underruns;
+  int audio_window_underruns;
+  int64_t audio_underrun_window;
 
   // wave display
   enum eShowMode show_mode;
@@ -3663,6 +7048,8 @@ public:
   double frame_last_filter_delay;
 
   struct SwsContext* sub_convert_ctx;
+  struct SwsContext* scale_convert_ctx;
+  cFrame* scaledFrame;            // last picture scaled into scaledTexture, redraws reuse it
   int eof;
 
   char* filename;
@@ -3671,31 +7058,77 @@ public:
   };
 //}}}
 
+//{{{
+void refreshLoopWaitEvent (cVideoState* videoState, SDL_Event* event) {
+// refresh the video until the next event arrives, sleeping until the next refresh deadline
+// - remaining_time < 0 sleeps until an event, frame pushes wake us with FF_REFRESH_EVENT
+
+  double remaining_time = 0.0;
+
+  SDL_PumpEvents();
+  while (!SDL_PeepEvents (event, 1, SDL_GETEVENT, SDL_FIRSTEVENT, SDL_LASTEVENT)) {
+    if (!cursor_hidden && av_gettime_relative() - cursor_last_shown > CURSOR_HIDE_DELAY) {
+      SDL_ShowCursor (0);
+      cursor_hidden = 1;
+      }
+
+    if (remaining_time > 0.0)
+      SDL_WaitEventTimeout (NULL, (int)ceil (remaining_time * 1000.0));
+    else if (remaining_time < 0.0)
+      SDL_WaitEvent (NULL);
+    gEventLoopWakeups++;
+
+    remaining_time = REFRESH_RATE;
+    if (videoState->scrubbing && videoState->thumbnailer.hasResult())
+      videoState->force_refresh = 1;
+    if ((videoState->show_mode != SHOW_MODE_NONE) &&
+        (!videoState->paused || videoState->force_refresh))
+      videoState->videoRefresh (&remaining_time);
+    else if (videoState->paused)
+      remaining_time = gShowStatus ? STATUS_REFRESH_RATE : -1.0;
+
+    // the audio callback can't reopen its own device, nor ask its latency without taking the device lock
+    int growSamples = SDL_AtomicSet (&videoState->audio_grow_samples, 0);
+    if (growSamples)
+      videoState->audioReopen (growSamples);
+    else if (videoState->audioStream)
+      videoState->pollAudioLatency();
+
+    // nor can the audio thread change the speed it is too slow to stretch, or the read thread set the starting one
+    if (SDL_AtomicSet (&videoState->stretchOverload, 0))
+      videoState->capStretch();
+    int speedRequest = SDL_AtomicSet (&videoState->speedRequest, 0);
+    if (speedRequest)
+      videoState->setSpeed (speedRequest / 1000.0);
+
+    // spend the slack before the next deadline uploading what the decoder has queued
+    int64_t uploadStart = av_gettime_relative();
+    videoState->preUploadPictures();
+    if (remaining_time > 0.0)
+      remaining_time = FFMAX(remaining_time - (av_gettime_relative() - uploadStart) / 1000000.0, 0.0);
+
+    if (gShowStatus)
+      videoState->showStatus();
+
+    if (!cursor_hidden) {
+      double cursor_time = (cursor_last_shown + CURSOR_HIDE_DELAY - av_gettime_relative()) / 1000000.0;
+      cursor_time = FFMAX(cursor_time, 0.001);
+      remaining_time = remaining_time < 0.0 ? cursor_time : FFMIN(remaining_time, cursor_time);
+      }
+
+    SDL_PumpEvents();
+    }
+  }
+//}}}
 //{{{
 void eventLoop (cVideoState* videoState) {
 // handle an event sent by the GUI
 
   for (;;) {
-    SDL_PumpEvents();
     SDL_Event event;
-    while (!SDL_PeepEvents (&event, 1, SDL_GETEVENT, SDL_FIRSTEVENT, SDL_LASTEVENT)) {
-      if (!cursor_hidden && av_gettime_relative() - cursor_last_shown > CURSOR_HIDE_DELAY) {
-        SDL_ShowCursor (0);
-        cursor_hidden = 1;
-        }
-
-      double remaining_time = 0.0;
-      if (remaining_time > 0.0)
-        av_usleep ((unsigned int)(remaining_time * 1000000.0));
-      remaining_time = REFRESH_RATE;
+    refreshLoopWaitEvent (videoState, &event);
 
-      if ((videoState->show_mode != SHOW_MODE_NONE) &&
-          (!videoState->paused || videoState->force_refresh))
-        videoState->videoRefresh (&remaining_time);
-      SDL_PumpEvents();
-      }
-
-    double x, incr, pos, frac;
+    double x, incr, pos;
     switch (event.type) {
       //{{{
       case SDL_KEYDOWN:
@@ -3715,6 +7148,8 @@ void eventLoop (cVideoState* videoState) {
           case SDLK_f: videoState->toggleFullScreen(); videoState->force_refresh = 1; break;
 
           case SDLK_m: videoState->toggleMute(); break;
+          case SDLK_RIGHTBRACKET: videoState->stepSpeed (1); break;
+          case SDLK_LEFTBRACKET: videoState->stepSpeed (-1); break;
           case SDLK_KP_MULTIPLY:
           case SDLK_0: videoState->updateVolume (1, SDL_VOLUME_STEP); break;
           case SDLK_KP_DIVIDE:
@@ -3772,12 +7207,14 @@ void eventLoop (cVideoState* videoState) {
             incr = -60.0;
           do_seek:
             //{{{  seek
-            if (seek_by_bytes) {
+            if (seek_by_bytes && !videoState->keyframeIndex.isUsable()) {
               pos = -1;
+              if (videoState->seekPending() && (videoState->seek_flags & AVSEEK_FLAG_BYTE))
+                pos = (double)videoState->seek_pos;
               if (pos < 0 && videoState->videoStreamId >= 0)
                 pos = (double)videoState->pictq.frame_queue_last_pos();
               if (pos < 0 && videoState->audioStreamId >= 0)
-                pos = (double)videoState->sampq.frame_queue_last_pos();
+                pos = (double)videoState->audioRing.lastPos();
               if (pos < 0)
                 pos = (double)avio_tell (videoState->formatContext->pb);
               if (videoState->formatContext->bit_rate)
@@ -3788,13 +7225,17 @@ void eventLoop (cVideoState* videoState) {
               videoState->streamSeek ((int64_t)pos, (int64_t)incr, 1);
               }
             else {
-              pos = videoState->get_master_clock();
+              // held keys step on from the pending target, not from where playback still is
+              if (videoState->seekPending() && !(videoState->seek_flags & AVSEEK_FLAG_BYTE))
+                pos = (double)videoState->seek_pos / AV_TIME_BASE;
+              else
+                pos = videoState->get_master_clock();
               if (isnan(pos))
                  pos = (double)videoState->seek_pos / AV_TIME_BASE;
               pos += incr;
               if (videoState->formatContext->start_time != AV_NOPTS_VALUE && pos < videoState->formatContext->start_time / (double)AV_TIME_BASE)
                 pos = videoState->formatContext->start_time / (double)AV_TIME_BASE;
-              videoState->streamSeek ((int64_t)(pos * AV_TIME_BASE), (int64_t)(incr * AV_TIME_BASE), 0);
+              videoState->streamSeek ((int64_t)(pos * AV_TIME_BASE), (int64_t)(incr * AV_TIME_BASE), 0, seek_by_bytes);
               }
             break;
             //}}}
@@ -3842,33 +7283,20 @@ void eventLoop (cVideoState* videoState) {
           x = event.motion.x;
           }
 
-        if (seek_by_bytes || videoState->formatContext->duration <= 0) {
-          uint64_t size =  avio_size(videoState->formatContext->pb);
-          videoState->streamSeek ((int64_t)(size * x /videoState->width), 0, 1);
-          }
+        // a right drag previews thumbnails and seeks once on release, seeks as it goes when it can't
+        if (!videoState->scrub (x))
+          videoState->seekToX (x);
 
-        else {
-          int tns  = (int)(videoState->formatContext->duration / 1000000LL);
-          int thh  = tns / 3600;
-          int tmm  = (tns % 3600) / 60;
-          int tss  = (tns % 60);
-
-          frac = x / videoState->width;
-          int ns = (int)(frac * tns);
-          int hh = ns / 3600;
-          int mm = (ns % 3600) / 60;
-          int ss = (ns % 60);
-
-          av_log (NULL, AV_LOG_INFO,
-                  "Seek to %2.0f%% (%2d:%02d:%02d) of total duration (%2d:%02d:%02d)       \n", frac*100,
-                  hh, mm, ss, thh, tmm, tss);
-
-          int64_t ts = (int64_t)(frac * videoState->formatContext->duration);
-          if (videoState->formatContext->start_time != AV_NOPTS_VALUE)
-            ts += videoState->formatContext->start_time;
-          videoState->streamSeek (ts, 0, 0);
+        break;
+      //}}}
+      //{{{
+      case SDL_MOUSEBUTTONUP:
+        if ((event.button.button == SDL_BUTTON_RIGHT) && videoState->scrubbing) {
+          // the one real seek of a drag, by time to where the thumbnail came from, even when seeking by bytes
+          videoState->scrubbing = false;
+          videoState->streamSeek (videoState->scrubTs, 0, 0);
+          videoState->force_refresh = 1;
           }
-
         break;
       //}}}
       //{{{
@@ -3892,6 +7320,11 @@ void eventLoop (cVideoState* videoState) {
 
         break;
       //}}}
+      //{{{
+      case FF_REFRESH_EVENT:
+        SDL_AtomicSet (&gRefreshEventPending, 0);
+        break;
+      //}}}
       case SDL_QUIT:
       //{{{
       case FF_QUIT_EVENT:
@@ -4078,6 +7511,12 @@ const OptionDef options[] = {
   { "framedrop", OPT_BOOL | OPT_EXPERT, { &framedrop }, "drop frames when cpu is too slow", "" },
 
   { "infbuf", OPT_BOOL | OPT_EXPERT, { &infinite_buffer }, "don't limit the input buffer size (useful with realtime streams)", "" },
+  { "readahead_low", OPT_DOUBLE | HAS_ARG | OPT_EXPERT, { &gReadAheadLow },
+      "seconds of packets per stream below which reading resumes", "secs" },
+  { "readahead_high", OPT_DOUBLE | HAS_ARG | OPT_EXPERT, { &gReadAheadHigh },
+      "seconds of packets per stream above which reading pauses", "secs" },
+  { "readahead_kb", OPT_INT | HAS_ARG | OPT_EXPERT, { &gReadAheadKB },
+      "per stream read-ahead byte budget, reading resumes below half of it", "KB" },
   { "gWindowTitle", OPT_STRING | HAS_ARG, { &gWindowTitle }, "set window title", "window title" },
 
   { "left", OPT_INT | HAS_ARG | OPT_EXPERT, { &screen_left }, "set the x position for the left of the window", "x pos" },
@@ -4099,6 +7538,31 @@ const OptionDef options[] = {
   { "find_stream_info", OPT_BOOL | OPT_INPUT | OPT_EXPERT, { &find_stream_info },
       "read and decode the streams to fill missing information with heuristics" },
   { "filter_threads", HAS_ARG | OPT_INT | OPT_EXPERT, { &filter_nbthreads }, "number of filter threads per graph" },
+  { "lowlatency", OPT_BOOL | OPT_EXPERT, { &gLowLatency },
+      "5 to 10ms audio callbacks for live monitoring, grown when the callback falls behind", "" },
+  { "audio_float", OPT_BOOL | OPT_EXPERT, { &gAudioFloat }, "open the audio device as f32, -noaudio_float for s16", "" },
+  { "upload_threads", HAS_ARG | OPT_INT | OPT_EXPERT, { &gUploadThreads },
+      "extra threads copying frame slices into the locked texture, 0 uploads on the render thread", "threads" },
+  { "bench", OPT_BOOL | OPT_EXPERT, { &gBench },
+      "decode and render every frame unpaced on the offscreen video and disk audio drivers, report per stage rates at exit", "" },
+  { "trick_keyframe_speed", OPT_DOUBLE | HAS_ARG | OPT_EXPERT, { &gTrickKeyframeSpeed },
+      "trick play speed from which only keyframes are read and decoded, ] and [ step the speed", "speed" },
+  { "speed", OPT_DOUBLE | HAS_ARG | OPT_EXPERT, { &gSpeed },
+      "start playing at this speed, 0.25 to 32, the audio is time stretched up to 4", "speed" },
+  { "accurate_seek", OPT_BOOL | OPT_EXPERT, { &gAccurateSeek },
+      "seek to the exact frame, decoding from the keyframe before it unpaced and unshown", "" },
+  { "kidx", OPT_BOOL | OPT_EXPERT, { &gKeyframeIndex },
+      "index the keyframes of transport streams on a background thread, cached under $XDG_CACHE_HOME/ffplay, for exact seeks", "" },
+  { "async_io", HAS_ARG | OPT_INT | OPT_EXPERT, { &gAsyncIo },
+      "read ahead of the demuxer on io threads, the number of reads in flight on a local file, a url gets one", "reads" },
+  { "mmap", OPT_BOOL | OPT_EXPERT, { &gMmap },
+      "read local files out of a memory mapping with madvise prefetch, not for files still being written or on network filesystems", "" },
+  { "trace", OPT_STRING | HAS_ARG | OPT_EXPERT, { &gTraceUrl },
+      "write demux, decode, filter, upload, present and audio callback spans as a chrome trace json at exit", "url" },
+  { "telemetry", OPT_STRING | HAS_ARG | OPT_EXPERT, { &gTelemetryUrl },
+      "write per frame sync and audio callback telemetry at exit, to a file or any avio url (tcp://, unix:)", "url" },
+  { "telemetry_format", OPT_STRING | HAS_ARG | OPT_EXPERT, { &gTelemetryFormat },
+      "telemetry format csv or json, default json for a .json url, else csv", "format" },
   { NULL, },
   };
 //}}}
@@ -4184,6 +7648,25 @@ int main (int argc, char** argv) {
     }
     //}}}
 
+  if (gBench) {
+    //{{{  headless, unpaced, every frame
+    // the real upload and render path, on drivers that need no display or sound card
+    // - env set by the user still wins, SDL_setenv does not overwrite
+    gDisplayDisable = 0;
+    framedrop = 0;
+    autoexit = 1;
+    loop = 1;
+    SDL_setenv ("SDL_VIDEODRIVER", "offscreen,dummy", 0);
+    SDL_setenv ("SDL_AUDIODRIVER", "disk", 0);
+    SDL_setenv ("SDL_DISKAUDIODELAY", "0", 0);
+    #ifdef _WIN32
+      SDL_setenv ("SDL_DISKAUDIOFILE", "NUL", 0);
+    #else
+      SDL_setenv ("SDL_DISKAUDIOFILE", "/dev/null", 0);
+    #endif
+    }
+    //}}}
+
   if (gDisplayDisable)
     gVideoDisable = 1;
   int flags = SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_TIMER;
@@ -4252,9 +7735,21 @@ int main (int argc, char** argv) {
       exit(0);
       }
       //}}}
+
+    if (gUploadThreads > 0)
+      gUploadPool.init (gUploadThreads);
     }
     //}}}
 
+  // before streamOpen, its threads record from the first frame
+  if (gTelemetryUrl && (gTelemetry.init (gTelemetryUrl, gTelemetryFormat) < 0))
+    exit (1);
+  if (gTraceUrl) {
+    gTrace.init (gTraceUrl);
+    gTrace.setThreadName ("main");
+    }
+
+  gBenchStartTime = getBenchTime();
   cVideoState* videoState = cVideoState::streamOpen (gFilename, gInputFileFormat);
   if (!videoState) {
     //{{{  error return